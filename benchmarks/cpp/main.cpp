@@ -0,0 +1,377 @@
+#include "cmd_line_args.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+/// Benchmarks for parse, getValue, addParam, getDescription and rendering of the help.
+///
+/// Usage: benchmarks [--out=results.json] [--minTime=200]
+/// Results are written as JSON, one entry per benchmark, so that runs can be compared by a script.
+/// Allocations are counted by replacing the global operator new.
+
+namespace {
+std::atomic<uint64_t> allocationCount = 0;
+}
+
+void* operator new(std::size_t size) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size ? size : 1)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	const std::size_t align = std::size_t(alignment);
+#ifdef _WIN32
+	void* ptr = _aligned_malloc(std::max<std::size_t>(size, 1), align);
+#else
+	// aligned_alloc requires the size to be a multiple of the alignment
+	void* ptr = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align);
+#endif
+	if (ptr) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void freeAligned(void* ptr) noexcept {
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+	return operator new(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+	freeAligned(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+	freeAligned(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+	freeAligned(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+	freeAligned(ptr);
+}
+
+namespace {
+
+using CMD::CommandLineArgs;
+using Clock = std::chrono::steady_clock;
+
+/// Prevent the compiler from removing the computation of value or moving it out of the loop
+template<typename T>
+void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &value;
+	_ReadWriteBarrier();
+#endif
+}
+
+struct Result {
+	std::string name;
+	/// Number of arguments, parameters or lookups processed by one operation
+	int items;
+	uint64_t iterations;
+	double nsPerOp;
+	double allocationsPerOp;
+};
+
+/// @brief Run op until it has run for at least minTime and record the average time and allocations per call
+template<typename OpT>
+Result measure(std::string name, const int items, const std::chrono::milliseconds minTime, OpT&& op) {
+	// Warm up, so that one time allocations (e.g. arena blocks) are not counted
+	op();
+	uint64_t iterations = 1;
+	for (;;) {
+		const uint64_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+		const Clock::time_point start = Clock::now();
+		for (uint64_t i = 0; i < iterations; ++i) {
+			op();
+		}
+		const Clock::duration elapsed = Clock::now() - start;
+		const uint64_t allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+		if (elapsed >= minTime || iterations >= (uint64_t(1) << 40)) {
+			const double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+			return Result{
+				std::move(name),
+				items,
+				iterations,
+				ns / double(iterations),
+				double(allocations) / double(iterations)
+			};
+		}
+		iterations *= 2;
+	}
+}
+
+const char* typeName(const CommandLineArgs::Type type) {
+	switch (type) {
+		case CommandLineArgs::Type::Int: return "int";
+		case CommandLineArgs::Type::String: return "string";
+		case CommandLineArgs::Type::Flag: return "flag";
+		case CommandLineArgs::Type::Int64: return "int64";
+		case CommandLineArgs::Type::UInt64: return "uint64";
+		case CommandLineArgs::Type::Double: return "double";
+		case CommandLineArgs::Type::Size: return "size";
+		case CommandLineArgs::Type::IntList: return "int_list";
+		case CommandLineArgs::Type::StringList: return "string_list";
+		case CommandLineArgs::Type::Custom: return "custom";
+	}
+	return "unknown";
+}
+
+/// @brief Parameters p0, p1, ... and one argument for each of them
+struct SyntheticArgs {
+	SyntheticArgs(const int count, const CommandLineArgs::Type type) {
+		names.reserve(count);
+		storage.reserve(count + 1);
+		storage.emplace_back("benchmark");
+		for (int i = 0; i < count; ++i) {
+			names.push_back("p" + std::to_string(i));
+			std::string arg = "--" + names.back();
+			switch (type) {
+				case CommandLineArgs::Type::Int: arg += "=" + std::to_string(i * 7919); break;
+				case CommandLineArgs::Type::String: arg += "=some/path/to/file_" + std::to_string(i) + ".txt"; break;
+				case CommandLineArgs::Type::Double: arg += "=" + std::to_string(i) + ".25e-3"; break;
+				case CommandLineArgs::Type::Size: arg += "=" + std::to_string(i + 1) + "M"; break;
+				case CommandLineArgs::Type::IntList: arg += "=1,2,3,4,5,6,7,8"; break;
+				case CommandLineArgs::Type::Flag: break;
+				default: arg += "=" + std::to_string(i); break;
+			}
+			storage.push_back(std::move(arg));
+		}
+		for (std::string& arg : storage) {
+			argv.push_back(arg.data());
+		}
+	}
+
+	void addParams(CommandLineArgs& parser, const CommandLineArgs::Type type) const {
+		for (const std::string& name : names) {
+			if (parser.addParam(type, name, "Benchmark parameter", false) != CommandLineArgs::ErrorCode::Success) {
+				std::fprintf(stderr, "Cannot add parameter %s\n", name.c_str());
+				std::exit(1);
+			}
+		}
+	}
+
+	std::vector<std::string> names;
+	std::vector<std::string> storage;
+	std::vector<char*> argv;
+};
+
+void benchmarkParse(std::vector<Result>& results, const std::chrono::milliseconds minTime) {
+	const CommandLineArgs::Type types[] = {
+		CommandLineArgs::Type::Int,
+		CommandLineArgs::Type::Double,
+		CommandLineArgs::Type::Size,
+		CommandLineArgs::Type::Flag,
+		CommandLineArgs::Type::String,
+		CommandLineArgs::Type::IntList
+	};
+	const int sizes[] = {1, 16, 256, 4096};
+	for (const CommandLineArgs::Type type : types) {
+		for (const int size : sizes) {
+			const SyntheticArgs args(size, type);
+			for (const CommandLineArgs::StringStorage storage : {CommandLineArgs::StringStorage::Copy, CommandLineArgs::StringStorage::View}) {
+				if (storage == CommandLineArgs::StringStorage::View && type != CommandLineArgs::Type::String) {
+					continue;
+				}
+				CommandLineArgs parser(storage);
+				args.addParams(parser, type);
+				std::string name = std::string("parse/") + typeName(type) + "/" + std::to_string(size);
+				if (storage == CommandLineArgs::StringStorage::View) {
+					name += "/view";
+				}
+				results.push_back(measure(std::move(name), size, minTime, [&]() {
+					// Lists append on each parse, free the values to keep their size constant
+					parser.freeValues();
+					const CommandLineArgs::ErrorCode code = parser.parse(int(args.argv.size()), const_cast<char**>(args.argv.data()));
+					doNotOptimize(code);
+				}));
+			}
+		}
+	}
+}
+
+void benchmarkParseString(std::vector<Result>& results, const std::chrono::milliseconds minTime) {
+	const CommandLineArgs::Type types[] = {CommandLineArgs::Type::Int, CommandLineArgs::Type::String};
+	const int sizes[] = {16, 256};
+	for (const CommandLineArgs::Type type : types) {
+		for (const int size : sizes) {
+			const SyntheticArgs args(size, type);
+			std::string commandLine;
+			for (std::size_t i = 1; i < args.storage.size(); ++i) {
+				commandLine += args.storage[i];
+				commandLine += ' ';
+			}
+			CommandLineArgs parser;
+			args.addParams(parser, type);
+			const std::string name = std::string("parse_string/") + typeName(type) + "/" + std::to_string(size);
+			results.push_back(measure(name, size, minTime, [&]() {
+				parser.freeValues();
+				const CommandLineArgs::ErrorCode code = parser.parse(commandLine);
+				doNotOptimize(code);
+			}));
+		}
+	}
+}
+
+void benchmarkGetValue(std::vector<Result>& results, const std::chrono::milliseconds minTime) {
+	const int sizes[] = {16, 4096};
+	for (const int size : sizes) {
+		const SyntheticArgs args(size, CommandLineArgs::Type::Int);
+		CommandLineArgs parser;
+		args.addParams(parser, CommandLineArgs::Type::Int);
+		if (parser.parse(int(args.argv.size()), const_cast<char**>(args.argv.data())) != CommandLineArgs::ErrorCode::Success) {
+			std::fprintf(stderr, "Cannot parse synthetic arguments\n");
+			std::exit(1);
+		}
+		results.push_back(measure("get_value/name/" + std::to_string(size), size, minTime, [&]() {
+			for (const std::string& name : args.names) {
+				doNotOptimize(parser.getValue<CommandLineArgs::Type::Int>(name));
+			}
+		}));
+		results.push_back(measure("get_value/id/" + std::to_string(size), size, minTime, [&]() {
+			for (CommandLineArgs::ParamId id = 0; id < CommandLineArgs::ParamId(size); ++id) {
+				doNotOptimize(parser.getValue<CommandLineArgs::Type::Int>(id));
+			}
+		}));
+	}
+}
+
+void benchmarkAddParam(std::vector<Result>& results, const std::chrono::milliseconds minTime) {
+	const int sizes[] = {16, 256, 4096};
+	for (const int size : sizes) {
+		const SyntheticArgs args(size, CommandLineArgs::Type::Int);
+		results.push_back(measure("add_param/" + std::to_string(size), size, minTime, [&]() {
+			CommandLineArgs parser;
+			args.addParams(parser, CommandLineArgs::Type::Int);
+			doNotOptimize(parser);
+		}));
+	}
+}
+
+void benchmarkDescription(std::vector<Result>& results, const std::chrono::milliseconds minTime) {
+	const int sizes[] = {16, 256, 4096};
+	for (const int size : sizes) {
+		const SyntheticArgs args(size, CommandLineArgs::Type::Int);
+		CommandLineArgs parser;
+		args.addParams(parser, CommandLineArgs::Type::Int);
+		results.push_back(measure("get_description/" + std::to_string(size), size, minTime, [&]() {
+			const std::string description = parser.getDescription();
+			doNotOptimize(description);
+		}));
+		// Changing the width drops the cached help, each iteration sorts and formats all parameters
+		unsigned width = 80;
+		results.push_back(measure("help_render/" + std::to_string(size), size, minTime, [&]() {
+			width = width == 80 ? 81 : 80;
+			parser.setHelpWidth(width);
+			const std::string_view help = parser.getHelp();
+			doNotOptimize(help);
+		}));
+	}
+}
+
+void writeResults(std::FILE* out, const std::vector<Result>& results) {
+	std::fprintf(out, "{\n\t\"results\": [\n");
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		const Result& result = results[i];
+		std::fprintf(
+			out,
+			"\t\t{\"name\": \"%s\", \"items\": %d, \"iterations\": %llu, \"ns_per_op\": %.2f, "
+			"\"ns_per_item\": %.3f, \"allocations_per_op\": %.2f}%s\n",
+			result.name.c_str(),
+			result.items,
+			static_cast<unsigned long long>(result.iterations),
+			result.nsPerOp,
+			result.nsPerOp / result.items,
+			result.allocationsPerOp,
+			i + 1 < results.size() ? "," : ""
+		);
+	}
+	std::fprintf(out, "\t]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	CommandLineArgs options;
+	CommandLineArgs::ParamId outId;
+	CommandLineArgs::ParamId minTimeId;
+	if (
+		options.addParam(CommandLineArgs::Type::String, "out", "JSON file for the results, stdout if not set", false, &outId) != CommandLineArgs::ErrorCode::Success ||
+		options.addParam(CommandLineArgs::Type::Int, "minTime", "Minimal time in milliseconds for each benchmark", false, &minTimeId) != CommandLineArgs::ErrorCode::Success
+	) {
+		return 1;
+	}
+	if (options.parse(argc, argv) != CommandLineArgs::ErrorCode::Success) {
+		std::fprintf(stderr, "%s\n", options.getDescription().c_str());
+		return 1;
+	}
+	const int* minTimeMs = options.getValue<CommandLineArgs::Type::Int>(minTimeId);
+	const std::chrono::milliseconds minTime(minTimeMs ? *minTimeMs : 200);
+
+	std::vector<Result> results;
+	benchmarkParse(results, minTime);
+	benchmarkParseString(results, minTime);
+	benchmarkGetValue(results, minTime);
+	benchmarkAddParam(results, minTime);
+	benchmarkDescription(results, minTime);
+
+	std::FILE* out = stdout;
+	if (const std::string* path = options.getValue<CommandLineArgs::Type::String>(outId)) {
+		out = std::fopen(path->c_str(), "w");
+		if (!out) {
+			std::fprintf(stderr, "Cannot open %s\n", path->c_str());
+			return 1;
+		}
+	}
+	writeResults(out, results);
+	if (out != stdout) {
+		std::fclose(out);
+	}
+	return 0;
+}
@@ -1,176 +1,2978 @@
 #include "cmd_line_args.h"
+#include "static_cmd_line_args.h"
 #include <cstring>
+#include <cstdlib>
+#include <cctype>
 #include <cassert>
 #include <cstdio>
 #include <format>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <charconv>
+#include <limits>
+#include <type_traits>
+#include <ostream>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
 
 namespace CMD {
 
-CommandLineArgs::ErrorCode CommandLineArgs::parse(const int argc, char** argv, ErrorCallbackT errorCallback) {
-    // argv[0] is the name of the program (exe), that is why the for starts from 1
-    programName = argv[0];
-    descriptionGenerated = false;
-    const int dashCount = 2;
-    for (int i = 1; i < argc; ++i) {
-        const char* arg = argv[i];
-        if (arg[0] == '-' && arg[1] == '-') {
-            int j = dashCount;
-            bool hasParams = false;
-            while (arg[j]) {
-                if (arg[j] == '=') {
-                    hasParams = true;
-                    break;
-                }
-                j++;
-            }
-
-            // -someArg=someVal -> arg + 2 to start past the '--' from 's'
-            // j-1 is the length, subtract 1 to account for the parameter
-            const int nameLen = j - dashCount;
-            std::string name(arg + dashCount, nameLen);
-            auto infoIterator = paramInfo.find(name);
-            if (infoIterator == paramInfo.end()) {
-                const ErrorCode code = ErrorCode::UnknownParameter;
-                if (errorCallback) {
-                    const std::string& error = std::format("Unknown parameter {}", name);
-                    errorCallback(code, name.c_str(), arg, error.c_str());
-                }
-                return code;
-            }
+namespace detail {
+
+/// @brief Response file mapped copy on write. The tokenizer writes into the mapping, the file on disk is
+/// not changed. Pages are read from the file only when the tokenizer reaches them.
+class MappedFile {
+public:
+    /// @brief Map the whole file
+    /// @return The mapped file or null if the file cannot be opened or mapped
+    static std::shared_ptr<MappedFile> open(const char* path);
+    /// @brief Copy text in memory, so that it can be split in place the same as a mapped file
+    static std::shared_ptr<MappedFile> copy(std::string_view text);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    char* begin() const {
+        return data;
+    }
+
+    char* end() const {
+        return data + size;
+    }
+
+    /// Copy of the last token, used when the token ends at the end of the file and there is no room
+    /// for its null terminator in the mapping
+    std::string tail;
+private:
+    MappedFile() = default;
+
+    char* data = nullptr;
+    std::size_t size = 0;
+    /// Owns the data of a copy, null for a mapped file
+    std::unique_ptr<char[]> copied;
+};
+
+std::shared_ptr<MappedFile> MappedFile::open(const char* path) {
+    std::shared_ptr<MappedFile> file(new MappedFile());
+#ifdef _WIN32
+    const HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        return nullptr;
+    }
+    if (size.QuadPart > 0) {
+        const HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (mapping != nullptr) {
+            file->data = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+            CloseHandle(mapping);
+        }
+        if (file->data == nullptr) {
+            CloseHandle(handle);
+            return nullptr;
+        }
+        file->size = std::size_t(size.QuadPart);
+    }
+    CloseHandle(handle);
+#else
+    const int fd = ::open(path, O_RDONLY);
+    if (fd == -1) {
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+    if (info.st_size > 0) {
+        void* data = mmap(nullptr, std::size_t(info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return nullptr;
+        }
+        madvise(data, std::size_t(info.st_size), MADV_SEQUENTIAL);
+        file->data = static_cast<char*>(data);
+        file->size = std::size_t(info.st_size);
+    }
+    close(fd);
+#endif
+    return file;
+}
+
+std::shared_ptr<MappedFile> MappedFile::copy(const std::string_view text) {
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    if (!text.empty()) {
+        file->copied = std::make_unique_for_overwrite<char[]>(text.size());
+        std::memcpy(file->copied.get(), text.data(), text.size());
+        file->data = file->copied.get();
+        file->size = text.size();
+    }
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (data == nullptr || copied) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+} // namespace detail
+
+namespace {
+
+using ErrorCode = CommandLineArgs::ErrorCode;
+using Type = CommandLineArgs::Type;
+using ErrorCallbackT = CommandLineArgs::ErrorCallbackT;
+using ParseStats = CommandLineArgs::ParseStats;
+
+/// @brief Null terminated text with fixed capacity. Error descriptions are built in it, so that
+/// reporting an error does not allocate. Text which does not fit is truncated.
+template<std::size_t Capacity>
+class ErrorText {
+public:
+    explicit ErrorText(std::string_view text) {
+        const std::size_t size = std::min(text.size(), Capacity - 1);
+        std::memcpy(data, text.data(), size);
+        data[size] = '\0';
+    }
+
+    template<typename... Args>
+    explicit ErrorText(std::format_string<Args...> format, Args&&... args) {
+        const auto result = std::format_to_n(data, Capacity - 1, format, std::forward<Args>(args)...);
+        *result.out = '\0';
+    }
+
+    const char* c_str() const {
+        return data;
+    }
+private:
+    char data[Capacity];
+};
+
+/// @brief Call the error callback (if any) and return the error code
+/// @param[in] errorCallback Callback passed to parse, can be null
+/// @param[in] code The code of the error
+/// @param[in] param The name of the parameter, it is not required to be null terminated
+/// @param[in] input The whole erroneous input
+/// @param[in] format Format string for the description of the error followed by its arguments
+template<typename... Args>
+ErrorCode reportError(
+    ErrorCallbackT errorCallback,
+    const ErrorCode code,
+    std::string_view param,
+    const char* input,
+    std::format_string<Args...> format,
+    Args&&... args
+) {
+    if (errorCallback) {
+        const ErrorText<256> name(param);
+        const ErrorText<1024> description(format, std::forward<Args>(args)...);
+        errorCallback(code, name.c_str(), input, description.c_str());
+    }
+    return code;
+}
+
+/// @brief Parse integer with the same syntax as strtol with base 0. Optional sign, followed by 0x for hex,
+/// 0 for octal or nothing for decimal. The whole text must be a number which fits in T.
+template<typename T>
+bool parseInteger(std::string_view text, T& out) {
+    bool negative = false;
+    if (!text.empty() && (text[0] == '+' || text[0] == '-')) {
+        negative = text[0] == '-';
+        text.remove_prefix(1);
+    }
+    int base = 10;
+    if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        base = 16;
+        text.remove_prefix(2);
+    } else if (text.size() > 1 && text[0] == '0') {
+        base = 8;
+        text.remove_prefix(1);
+    }
+    // Parse the magnitude as unsigned, so that the sign is not accepted twice and the
+    // minimal value of signed types can be parsed.
+    using UnsignedT = std::make_unsigned_t<T>;
+    UnsignedT magnitude;
+    const char* end = text.data() + text.size();
+    const auto [next, error] = std::from_chars(text.data(), end, magnitude, base);
+    if (text.empty() || error != std::errc() || next != end) {
+        return false;
+    }
+    if constexpr (std::is_signed_v<T>) {
+        const UnsignedT limit = UnsignedT(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+        if (magnitude > limit) {
+            return false;
+        }
+        out = negative ? T(UnsignedT(0) - magnitude) : T(magnitude);
+    } else {
+        if (negative && magnitude != 0) {
+            return false;
+        }
+        out = magnitude;
+    }
+    return true;
+}
+
+bool parseDouble(std::string_view text, double& out) {
+    // from_chars does not accept leading +
+    if (!text.empty() && text[0] == '+') {
+        text.remove_prefix(1);
+    }
+    const char* end = text.data() + text.size();
+    const auto [next, error] = std::from_chars(text.data(), end, out);
+    return !text.empty() && error == std::errc() && next == end;
+}
+
+/// @brief Parse unsigned integer followed by optional K, M, G, T or P suffix
+bool parseSize(std::string_view text, uint64_t& out) {
+    int shift = 0;
+    if (!text.empty()) {
+        switch (text.back()) {
+            case 'k': case 'K': shift = 10; break;
+            case 'm': case 'M': shift = 20; break;
+            case 'g': case 'G': shift = 30; break;
+            case 't': case 'T': shift = 40; break;
+            case 'p': case 'P': shift = 50; break;
+        }
+    }
+    if (shift) {
+        text.remove_suffix(1);
+    }
+    uint64_t value;
+    if (!parseInteger(text, value) || value > (std::numeric_limits<uint64_t>::max() >> shift)) {
+        return false;
+    }
+    out = value << shift;
+    return true;
+}
+
+/// @brief Parse the value of a flag in a config file or in the environment. Case insensitive true, yes,
+/// on and 1 set the flag, false, no, off and 0 clear it.
+bool parseBool(std::string_view text, bool& out) {
+    const auto equals = [text](std::string_view word) {
+        return std::equal(text.begin(), text.end(), word.begin(), word.end(), [](char a, char b) {
+            return std::tolower(static_cast<unsigned char>(a)) == b;
+        });
+    };
+    if (equals("true") || equals("yes") || equals("on") || equals("1")) {
+        out = true;
+        return true;
+    }
+    if (equals("false") || equals("no") || equals("off") || equals("0")) {
+        out = false;
+        return true;
+    }
+    return false;
+}
+
+/// @brief Text shown in the error message when value of given type cannot be parsed
+constexpr const char* expectedValue(const Type type) {
+    switch (type) {
+        case Type::Int:
+        case Type::Int64: return "INTEGER_VALUE";
+        case Type::UInt64: return "UNSIGNED_INTEGER_VALUE";
+        case Type::Double: return "FLOATING_POINT_VALUE";
+        case Type::Size: return "SIZE_VALUE";
+        case Type::IntList: return "INTEGER_VALUE,...";
+        case Type::StringList: return "VALUE,...";
+        default: return "VALUE";
+    }
+}
+
+/// @brief Call onItem for each comma separated item of value, stop when it returns false.
+/// Commas are located with memchr which libc implements with SIMD, so long lists are not
+/// scanned byte by byte.
+/// @return false if onItem returned false, true otherwise
+template<typename OnItemT>
+bool forEachListItem(const std::string_view value, OnItemT&& onItem) {
+    const char* it = value.data();
+    const char* const last = it + value.size();
+    for (;;) {
+        const char* comma = static_cast<const char*>(std::memchr(it, ',', last - it));
+        const char* itemEnd = comma ? comma : last;
+        if (!onItem(std::string_view(it, itemEnd - it))) {
+            return false;
+        }
+        if (!comma) {
+            return true;
+        }
+        it = comma + 1;
+    }
+}
+
+std::size_t countListItems(const std::string_view value) {
+    return std::count(value.begin(), value.end(), ',') + 1;
+}
+
+/// @brief Make room for count more elements. Grows at least twice, so that appending to a list on each
+/// repeated parameter stays linear. Memory from the arena is not reused, growing by the exact size each
+/// time would also use quadratic memory.
+template<typename ContainerT>
+void reserveAdditional(ContainerT& container, const std::size_t count) {
+    const std::size_t required = container.size() + count;
+    if (required > container.capacity()) {
+        container.reserve(std::max(required, container.capacity() * 2));
+    }
+}
 
-            // Check values passed to parameters
-            // Flags should not have values
-            // Other types must have values
-            if (hasParams && infoIterator->second.type == Type::Flag) {
-                const ErrorCode code = ErrorCode::FlagHasValue;
-                if (errorCallback) {
-                    const std::string& error = std::format(
-                        "Parameter {} is a flag parameter. It does not have value!"
+/// @brief Add the time between construction and stop (or destruction) to one phase of ParseStats.
+/// Empty when the library is built without CMD_LINE_ARGS_INSTRUMENTATION.
+class PhaseTimer {
+public:
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+    PhaseTimer(ParseStats* stats, std::chrono::nanoseconds ParseStats::* phase) :
+        stats(stats),
+        phase(phase),
+        start(stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point())
+    { }
+
+    ~PhaseTimer() {
+        stop();
+    }
+
+    void stop() {
+        if (stats) {
+            stats->*phase += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            stats = nullptr;
+        }
+    }
+private:
+    ParseStats* stats;
+    std::chrono::nanoseconds ParseStats::* phase;
+    std::chrono::steady_clock::time_point start;
+#else
+    PhaseTimer(ParseStats*, std::chrono::nanoseconds ParseStats::*) { }
+
+    void stop() { }
+#endif
+};
+
+void countArgument([[maybe_unused]] ParseStats* stats) {
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+    if (stats) {
+        ++stats->argumentCount;
+    }
+#endif
+}
+
+/// @brief Check and store the value of a parameter found in the schema of TargetT. Shared between
+/// CommandLineArgs and StaticCommandLineArgs, which differ only by how names are looked up and
+/// where the values are stored.
+/// @param[in] param The parameter returned by find or findShort
+/// @param[in] name The name of the parameter as it was passed, used in error messages
+/// @param[in] valueText The value, null terminated, or null if no value was passed
+/// @param[in] input The whole input for the parameter, used in error messages
+/// TargetT must provide:
+///		- Param find(std::string_view name) where Param has type(), is convertible to bool and is default constructible
+///		- void setValue(const Param&, T) for int, int64_t, uint64_t and double
+///		- void setString(const Param&, std::string_view), void setFlag(const Param&)
+///		- ErrorCode checkRequired(ErrorCallbackT)
+///		- static constexpr bool supportsLists, if true also bool appendIntList(const Param&, std::string_view)
+///		and bool appendStringList(const Param&, std::string_view)
+///		- void retainFile(std::shared_ptr<const detail::MappedFile>), called for each response file and command line before
+///		its arguments are parsed. Strings stored as views point into the file.
+///		- ParseStats* stats, receives the phase timings, can be null
+///		- static constexpr bool supportsPositionals, if true also bool acceptsPositionals() and
+///		ErrorCode addPositional(std::string_view). Arguments which do not start with -- are positional
+///		when acceptsPositionals returns true.
+///		- static constexpr bool supportsValidators, if true also void addValidation(const Param&, const char* value),
+///		called for each converted value of a non flag parameter. The value is null terminated.
+///		- static constexpr bool supportsSources, if true also bool flagsTakeValue() and void clearFlag(const Param&).
+///		When flagsTakeValue returns true, flags accept a boolean value which sets or clears them.
+///		- static constexpr bool supportsCustomTypes, if true also bool setCustom(const Param&, std::string_view)
+///		which converts the value with the CMD::ValueParser of the parameter.
+///		- static constexpr bool supportsShortNames, if true also Param findShort(char) which finds the parameter
+///		by its one character name.
+template<typename TargetT>
+ErrorCode storeValue(
+    TargetT& target,
+    const typename TargetT::Param& param,
+    const std::string_view name,
+    const char* valueText,
+    const char* input,
+    ErrorCallbackT errorCallback
+) {
+    const bool hasValue = valueText != nullptr;
+    const std::string_view value = hasValue ? std::string_view(valueText) : std::string_view();
+
+    // Check values passed to parameters
+    // Flags should not have values
+    // Other types must have values
+    if (hasValue && param.type() == Type::Flag) {
+        if constexpr (TargetT::supportsSources) {
+            if (target.flagsTakeValue()) {
+                bool enabled;
+                if (!parseBool(value, enabled)) {
+                    return reportError(
+                        errorCallback,
+                        ErrorCode::WrongValueType,
+                        name,
+                        input,
+                        "Wrong value for flag {}. Expected: true, false, yes, no, on, off, 1 or 0"
                         "Received input is: {}",
-                        name.c_str(),
-                        arg
+                        name,
+                        input
                     );
-                    errorCallback(code, name.c_str(), arg, error.c_str());
                 }
-                return code;
-            } else if (!hasParams && infoIterator->second.type != Type::Flag) {
-                const ErrorCode code = ErrorCode::MissingValue;
-                if (errorCallback) {
-                    const std::string& error = std::format(
-                        "Parameter must receive value. The syntax is -parameter=value (no spaces surrounding =)"
-                        "Received input is: {}",
-                        arg
-                    );
-                    errorCallback(code, name.c_str(), arg, error.c_str());
+                if (enabled) {
+                    target.setFlag(param);
+                } else {
+                    target.clearFlag(param);
                 }
-                return code;
+                return ErrorCode::Success;
             }
-            
-            // Parse the value for the parameter
-            ParamVal val;
-            const int paramStartIndex = j + 1;
-            switch (infoIterator->second.type) {
-                case Type::Int: {
-                    char* next;
-                    const int res = strtol(arg + paramStartIndex, &next, 0);
-                    // strtol returns 0 if it cannot parse, so there are two possibilities to get 0
-                    // a) It could not parse
-                    // b) It parsed a zero
-                    // So check if the number is 0
-                    // second parameter of strtol returns which is the next char after the last parsed char
-                    // we want it to be the end of the string
-                    if ((res == 0 && arg[j + 1] != '0') || *next != '\0') {
-                        const ErrorCode code = ErrorCode::WrongValueType;
-                        if (errorCallback) {
-                            const std::string& error = std::format(
-                                "Wrong parameter value. Expected: -{}=[INTEGER_VALUE]"
-                                "Received input is: {}",
-                                arg,
-                                arg
-                            );
-                            errorCallback(ErrorCode::WrongValueType, name.c_str(), arg, error.c_str());
-                        }
-                        return code;
-                    }
-                    val = res;
-                } break;
-                case Type::String: {
-                    if (arg[paramStartIndex] == '\0') {
-                        return ErrorCode::MissingValue;
-                    }
-                    val = std::string(arg + paramStartIndex);
-                } break;
-                case Type::Flag: {
-                    val = true;
-                } break;
-                default: {
-                    assert(false);
-                    const ErrorCode code = ErrorCode::UnknownParsingError;
-                    if (errorCallback) {
-                        const std::string& error = std::format(
-                            "Unknown input %s. All arguments must start with \'-\' and use \'=\' for setting value."
-                            "There must be no intervals surrounding \'=\' or after the \'-\'!",
-                            arg
-                        );
-                        errorCallback(code, name.c_str(), arg, error.c_str());
-                    }
-                    return code;
+        }
+        return reportError(
+            errorCallback,
+            ErrorCode::FlagHasValue,
+            name,
+            input,
+            "Parameter {} is a flag parameter. It does not have value!"
+            "Received input is: {}",
+            name,
+            input
+        );
+    } else if (!hasValue && param.type() != Type::Flag) {
+        return reportError(
+            errorCallback,
+            ErrorCode::MissingValue,
+            name,
+            input,
+            "Parameter must receive value. The syntax is --name=value, --name value, -n value or -nvalue "
+            "(no spaces surrounding =). Received input is: {}",
+            input
+        );
+    }
+    
+    // Parse the value for the parameter
+    PhaseTimer convertTimer(target.stats, &ParseStats::convertTime);
+    bool parsed = true;
+    switch (param.type()) {
+        case Type::Int: {
+            int res;
+            if ((parsed = parseInteger(value, res))) {
+                target.setValue(param, res);
+            }
+        } break;
+        case Type::Int64: {
+            int64_t res;
+            if ((parsed = parseInteger(value, res))) {
+                target.setValue(param, res);
+            }
+        } break;
+        case Type::UInt64: {
+            uint64_t res;
+            if ((parsed = parseInteger(value, res))) {
+                target.setValue(param, res);
+            }
+        } break;
+        case Type::Size: {
+            uint64_t res;
+            if ((parsed = parseSize(value, res))) {
+                target.setValue(param, res);
+            }
+        } break;
+        case Type::Double: {
+            double res;
+            if ((parsed = parseDouble(value, res))) {
+                target.setValue(param, res);
+            }
+        } break;
+        case Type::String: {
+            if (value.empty()) {
+                return ErrorCode::MissingValue;
+            }
+            target.setString(param, value);
+        } break;
+        case Type::Flag: {
+            target.setFlag(param);
+        } break;
+        case Type::Custom: {
+            if constexpr (TargetT::supportsCustomTypes) {
+                parsed = target.setCustom(param, value);
+            } else {
+                assert(false);
+                parsed = false;
+            }
+        } break;
+        case Type::IntList:
+        case Type::StringList: {
+            if constexpr (TargetT::supportsLists) {
+                if (value.empty()) {
+                    return ErrorCode::MissingValue;
                 }
+                parsed = param.type() == Type::IntList ?
+                    target.appendIntList(param, value) :
+                    target.appendStringList(param, value);
+                break;
             }
-            paramValues[name] = val;
-        } else {
-            const ErrorCode code = ErrorCode::WrongParamFormat;
-            if (errorCallback) {
-                const std::string& error = std::format(
-                    "Unknown input %s. All arguments must start with \'-\' and use \'=\' for setting value."
-                    "There must be no intervals surrounding \'=\' or after the \'-\'!",
-                    arg
-                );
-                errorCallback(code, arg, arg, error.c_str());
+            [[fallthrough]];
+        }
+        default: {
+            assert(false);
+            return reportError(
+                errorCallback,
+                ErrorCode::UnknownParsingError,
+                name,
+                input,
+                "Unknown input {}. All arguments must start with \'-\' and use \'=\' for setting value."
+                "There must be no intervals surrounding \'=\' or after the \'-\'!",
+                input
+            );
+        }
+    }
+    convertTimer.stop();
+    if (!parsed) {
+        return reportError(
+            errorCallback,
+            ErrorCode::WrongValueType,
+            name,
+            input,
+            "Wrong parameter value. Expected: --{}=[{}]"
+            "Received input is: {}",
+            name,
+            expectedValue(param.type()),
+            input
+        );
+    }
+    if constexpr (TargetT::supportsValidators) {
+        if (param.type() != Type::Flag) {
+            target.addValidation(param, value.data());
+        }
+    }
+    return ErrorCode::Success;
+}
+
+/// @brief Find a parameter by name and store its value, see storeValue
+/// @param[in] name The name of the parameter without the dashes
+template<typename TargetT>
+ErrorCode setParam(
+    TargetT& target,
+    const std::string_view name,
+    const char* valueText,
+    const char* input,
+    ErrorCallbackT errorCallback
+) {
+    PhaseTimer lookupTimer(target.stats, &ParseStats::lookupTime);
+    const auto param = target.find(name);
+    lookupTimer.stop();
+    if (!param) {
+        return reportError(errorCallback, ErrorCode::UnknownParameter, name, input, "Unknown parameter {}", name);
+    }
+    return storeValue(target, param, name, valueText, input, errorCallback);
+}
+
+/// @brief State carried from one argument to the next while argv, response files and command lines are parsed
+template<typename TargetT>
+struct ArgumentState {
+    /// True after --, all following arguments are positional
+    bool afterTerminator = false;
+    /// Parameter which was passed without a value, e.g. --jobs 8 or -j 8. The next argument is its value.
+    typename TargetT::Param pending{};
+    std::string_view pendingName;
+    /// The argument which named the pending parameter, null if there is no pending parameter
+    const char* pendingInput = nullptr;
+
+    void setPending(const typename TargetT::Param& param, const std::string_view name, const char* input) {
+        pending = param;
+        pendingName = name;
+        pendingInput = input;
+    }
+
+    /// @brief Report a pending parameter at the end of the arguments, it has no value
+    ErrorCode finish(TargetT& target, ErrorCallbackT errorCallback) {
+        if (pendingInput == nullptr) {
+            return ErrorCode::Success;
+        }
+        return storeValue(target, pending, pendingName, nullptr, std::exchange(pendingInput, nullptr), errorCallback);
+    }
+};
+
+/// @brief Parse bundled short options, e.g. -vx, -j8 or -vj 8. Each character is looked up in a table with
+/// 256 entries. Flags can be followed by more options, the first option which takes a value takes the rest
+/// of the argument or, if nothing follows it, the next argument.
+template<typename TargetT>
+ErrorCode parseShortOptions(
+    TargetT& target,
+    const char* arg,
+    ArgumentState<TargetT>& state,
+    ErrorCallbackT errorCallback
+) {
+    for (const char* it = arg + 1; *it != '\0'; ++it) {
+        const std::string_view name(it, 1);
+        const auto param = target.findShort(*it);
+        if (!param) {
+            return reportError(errorCallback, ErrorCode::UnknownParameter, name, arg, "Unknown option -{}", name);
+        }
+        if (param.type() != Type::Flag) {
+            if (it[1] == '\0') {
+                state.setPending(param, name, arg);
+                return ErrorCode::Success;
             }
+            return storeValue(target, param, name, it + 1, arg, errorCallback);
+        }
+        const ErrorCode code = storeValue(target, param, name, nullptr, arg, errorCallback);
+        if (code != ErrorCode::Success) {
             return code;
         }
     }
+    return ErrorCode::Success;
+}
+
+/// @brief Check one argument from argv or from a response file and store its value
+template<typename TargetT>
+ErrorCode parseArgument(TargetT& target, const char* arg, ArgumentState<TargetT>& state, ErrorCallbackT errorCallback) {
+    const int dashCount = 2;
+    countArgument(target.stats);
+    if (arg[0] == '-' && arg[1] == '-') {
+        PhaseTimer tokenizeTimer(target.stats, &ParseStats::tokenizeTime);
+        // --someArg=someVal -> arg + 2 to start past the '--' from 's'. strchr and strlen are
+        // vectorized by libc.
+        const char* const nameBegin = arg + dashCount;
+        const char* const equals = std::strchr(nameBegin, '=');
+        const std::string_view name(nameBegin, equals ? std::size_t(equals - nameBegin) : std::strlen(nameBegin));
+        tokenizeTimer.stop();
+        if (equals) {
+            return setParam(target, name, equals + 1, arg, errorCallback);
+        }
+        PhaseTimer lookupTimer(target.stats, &ParseStats::lookupTime);
+        const auto param = target.find(name);
+        lookupTimer.stop();
+        if (!param) {
+            return reportError(errorCallback, ErrorCode::UnknownParameter, name, arg, "Unknown parameter {}", name);
+        }
+        // --name value, the value is the next argument
+        if (param.type() != Type::Flag) {
+            state.setPending(param, name, arg);
+            return ErrorCode::Success;
+        }
+        return storeValue(target, param, name, nullptr, arg, errorCallback);
+    }
+    if constexpr (TargetT::supportsShortNames) {
+        // Arguments whose first character is not a short name keep their meaning, e.g. -5 can be positional
+        if (arg[0] == '-' && arg[1] != '\0' && target.findShort(arg[1])) {
+            return parseShortOptions(target, arg, state, errorCallback);
+        }
+    }
+    if constexpr (TargetT::supportsPositionals) {
+        if (target.acceptsPositionals()) {
+            return target.addPositional(arg);
+        }
+    }
+    return reportError(
+        errorCallback,
+        ErrorCode::WrongParamFormat,
+        arg,
+        arg,
+        "Unknown input {}. All arguments must start with \'-\' and use \'=\' for setting value."
+        "There must be no intervals surrounding \'=\' or after the \'-\'!",
+        arg
+    );
+}
+
+/// @brief Splits a response file or a command line passed as one string into arguments in place
+///
+/// Arguments are separated by whitespace. Single quotes keep everything up to the closing quote, double
+/// quotes do the same but a backslash escapes a double quote or a backslash inside them, outside of quotes a backslash
+/// escapes any character. Quotes and escapes are removed by moving the rest of the argument back and each
+/// argument is null terminated in the mapping, so arguments are used without copying them. Most arguments
+/// have no quotes and no escapes, they are scanned 8 bytes at a time and nothing is moved.
+class ArgumentTokenizer {
+public:
+    explicit ArgumentTokenizer(detail::MappedFile& file) :
+        file(file),
+        it(file.begin()),
+        end(file.end()),
+        unclosedQuote(false)
+    { }
+
+    /// @return The next argument or null at the end of the file or if a quote is not closed
+    char* next() {
+        while (it != end && isSpace(*it)) {
+            ++it;
+        }
+        if (it == end) {
+            return nullptr;
+        }
+        char* const begin = it;
+        it = findSpecial(it, end);
+        char* out = it;
+        char quote = 0;
+        while (it != end) {
+            char c = *it;
+            if (quote != 0) {
+                if (c == quote) {
+                    quote = 0;
+                    ++it;
+                    continue;
+                }
+                if (quote == '"' && c == '\\' && it + 1 != end && (it[1] == '"' || it[1] == '\\')) {
+                    c = *++it;
+                }
+            } else if (isSpace(c)) {
+                break;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+                ++it;
+                continue;
+            } else if (c == '\\' && it + 1 != end) {
+                c = *++it;
+            }
+            *out++ = c;
+            ++it;
+        }
+        if (quote != 0) {
+            unclosedQuote = true;
+            return nullptr;
+        }
+        if (out == end) {
+            file.tail.assign(begin, out);
+            return file.tail.data();
+        }
+        // out is before it, or at the delimiter which is no longer needed
+        *out = '\0';
+        if (it != end) {
+            ++it;
+        }
+        return begin;
+    }
+
+    bool hasUnclosedQuote() const {
+        return unclosedQuote;
+    }
+private:
+    static bool isSpace(const char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    /// @brief Check if any byte of word is below 0x21 (whitespace or a control character), a quote or a
+    /// backslash. Each check sets the high bit of the matching bytes, bytes after a match can also be set.
+    static bool mayHaveSpecial(const uint64_t word) {
+        constexpr uint64_t ones = 0x0101010101010101ull;
+        constexpr uint64_t highBits = 0x8080808080808080ull;
+        const auto hasZero = [](uint64_t x) {
+            return (x - ones) & ~x & highBits;
+        };
+        const uint64_t below = (word - ones * 0x21) & ~word & highBits;
+        return (below | hasZero(word ^ (ones * '"')) | hasZero(word ^ (ones * '\'')) | hasZero(word ^ (ones * '\\'))) != 0;
+    }
 
-    // Check if all required parameters are passed
-    for (auto& it : paramInfo) {
-        if (it.second.required && paramValues.find(it.first) == paramValues.end()) {
-            const ErrorCode code = ErrorCode::MissingParameter;
-            if (errorCallback) {
-                const std::string& error = std::format("Required parameter {} cannot be found!", it.first.c_str());
-                errorCallback(ErrorCode::MissingParameter, it.first.c_str(), "", error.c_str());
+    /// @return The first whitespace, quote or backslash in [it, end) or end
+    static char* findSpecial(char* it, char* const end) {
+        while (end - it >= 8) {
+            uint64_t word;
+            std::memcpy(&word, it, sizeof(word));
+            if (mayHaveSpecial(word)) {
+                break;
             }
+            it += 8;
+        }
+        while (it != end && !isSpace(*it) && *it != '"' && *it != '\'' && *it != '\\') {
+            ++it;
+        }
+        return it;
+    }
+
+    detail::MappedFile& file;
+    char* it;
+    char* const end;
+    bool unclosedQuote;
+};
+
+/// Response files can include other response files up to this depth. It also stops files which include
+/// themselves.
+constexpr int maxResponseFileDepth = 16;
+
+template<typename TargetT>
+ErrorCode parseToken(
+    TargetT& target,
+    const char* arg,
+    int depth,
+    ArgumentState<TargetT>& state,
+    ErrorCallbackT errorCallback
+);
+
+/// @brief Split a response file or a command line into arguments and parse them one by one while it is
+/// split, so the memory used does not depend on the number of arguments.
+/// @param[in] depth The depth of the arguments, as passed to parseToken
+/// @param[out] unclosedQuote Set to true if the text ends inside a quote
+template<typename TargetT>
+ErrorCode parseTokens(
+    TargetT& target,
+    detail::MappedFile& file,
+    const int depth,
+    ArgumentState<TargetT>& state,
+    bool& unclosedQuote,
+    ErrorCallbackT errorCallback
+) {
+    ArgumentTokenizer tokenizer(file);
+    for (;;) {
+        PhaseTimer tokenizeTimer(target.stats, &ParseStats::tokenizeTime);
+        const char* token = tokenizer.next();
+        tokenizeTimer.stop();
+        if (!token) {
+            break;
+        }
+        const ErrorCode code = parseToken(target, token, depth, state, errorCallback);
+        if (code != ErrorCode::Success) {
             return code;
         }
     }
+    unclosedQuote = tokenizer.hasUnclosedQuote();
     return ErrorCode::Success;
 }
 
-CommandLineArgs::~CommandLineArgs() {
-	freeMem();
+/// @brief Parse the arguments in a response file
+/// @param[in] arg The argument naming the file, @ followed by the path
+/// @param[in] depth How many response files include this one, 1 for files passed on the command line
+/// @param[in,out] state The state of the arguments around the file
+template<typename TargetT>
+ErrorCode parseResponseFile(
+    TargetT& target,
+    const char* arg,
+    const int depth,
+    ArgumentState<TargetT>& state,
+    ErrorCallbackT errorCallback
+) {
+    const char* path = arg + 1;
+    if (depth > maxResponseFileDepth) {
+        return reportError(
+            errorCallback,
+            ErrorCode::ResponseFileError,
+            path,
+            arg,
+            "Response file {} is nested more than {} levels deep",
+            path,
+            maxResponseFileDepth
+        );
+    }
+    const std::shared_ptr<detail::MappedFile> file = detail::MappedFile::open(path);
+    if (!file) {
+        return reportError(errorCallback, ErrorCode::ResponseFileError, path, arg, "Cannot read response file {}", path);
+    }
+    target.retainFile(file);
+    bool unclosedQuote = false;
+    const ErrorCode code = parseTokens(target, *file, depth, state, unclosedQuote, errorCallback);
+    if (code != ErrorCode::Success) {
+        return code;
+    }
+    if (unclosedQuote) {
+        return reportError(
+            errorCallback,
+            ErrorCode::ResponseFileError,
+            path,
+            arg,
+            "Response file {} has a quote which is not closed",
+            path
+        );
+    }
+    return ErrorCode::Success;
 }
 
-void CommandLineArgs::freeValues() {
-	paramValues.clear();
+/// @brief Reads the key=value lines of a config file in place
+///
+/// Empty lines and lines starting with # or ; are skipped. A line [section] starts a section, the keys which
+/// follow it are prefixed with "section.". Whitespace around keys and values is ignored and a value can be
+/// quoted with ' or " to keep its whitespace. A line without = is a key without value, used for flags.
+/// Values are null terminated in the mapping, so they are used without copying them.
+class ConfigFileReader {
+public:
+    struct Entry {
+        /// The key without the section
+        std::string_view key;
+        /// Null terminated value or null if the line has no =
+        const char* value;
+        /// The value or the null terminated key if there is no value, used in error messages
+        const char* input;
+    };
+
+    explicit ConfigFileReader(detail::MappedFile& file) :
+        file(file),
+        it(file.begin()),
+        end(file.end()),
+        lineNumber(0),
+        invalidLine(false)
+    { }
+
+    /// @brief Read the next entry
+    /// @return false at the end of the file or at an invalid line, see hasInvalidLine
+    bool next(Entry& entry) {
+        while (it != end) {
+            char* lineEnd = static_cast<char*>(std::memchr(it, '\n', end - it));
+            if (lineEnd == nullptr) {
+                lineEnd = end;
+            }
+            char* const begin = skipSpace(it, lineEnd);
+            char* const last = trimSpace(begin, lineEnd);
+            it = lineEnd == end ? end : lineEnd + 1;
+            ++lineNumber;
+            if (begin == last || *begin == '#' || *begin == ';') {
+                continue;
+            }
+            if (*begin == '[') {
+                if (last[-1] != ']') {
+                    invalidLine = true;
+                    return false;
+                }
+                char* const sectionBegin = skipSpace(begin + 1, last - 1);
+                currentSection = std::string_view(sectionBegin, trimSpace(sectionBegin, last - 1) - sectionBegin);
+                continue;
+            }
+            char* const equals = static_cast<char*>(std::memchr(begin, '=', last - begin));
+            char* const keyEnd = trimSpace(begin, equals ? equals : last);
+            if (keyEnd == begin) {
+                invalidLine = true;
+                return false;
+            }
+            entry.key = std::string_view(begin, keyEnd - begin);
+            if (equals == nullptr) {
+                entry.value = nullptr;
+                entry.input = terminate(begin, keyEnd);
+                return true;
+            }
+            char* valueBegin = skipSpace(equals + 1, last);
+            char* valueEnd = last;
+            if (valueEnd - valueBegin >= 2 && (*valueBegin == '"' || *valueBegin == '\'') && valueEnd[-1] == *valueBegin) {
+                ++valueBegin;
+                --valueEnd;
+            }
+            entry.value = terminate(valueBegin, valueEnd);
+            entry.input = entry.value;
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief The section of the last entry, empty before the first [section]
+    std::string_view section() const {
+        return currentSection;
+    }
+
+    bool hasInvalidLine() const {
+        return invalidLine;
+    }
+
+    /// @brief Number of the last line which was read, starting from 1
+    int line() const {
+        return lineNumber;
+    }
+private:
+    static bool isSpace(const char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    static char* skipSpace(char* begin, char* const end) {
+        while (begin != end && isSpace(*begin)) {
+            ++begin;
+        }
+        return begin;
+    }
+
+    /// @return One past the last character in [begin, end) which is not a space
+    static char* trimSpace(char* const begin, char* end) {
+        while (end != begin && isSpace(end[-1])) {
+            --end;
+        }
+        return end;
+    }
+
+    /// @brief Null terminate the text [begin, end). The character at end is no longer needed.
+    const char* terminate(char* const begin, char* const end) {
+        if (end == file.end()) {
+            file.tail.assign(begin, end);
+            return file.tail.data();
+        }
+        *end = '\0';
+        return begin;
+    }
+
+    detail::MappedFile& file;
+    char* it;
+    char* const end;
+    std::string_view currentSection;
+    int lineNumber;
+    bool invalidLine;
+};
+
+/// @brief Set the parameters from a config file, see ConfigFileReader for the format
+template<typename TargetT>
+ErrorCode parseConfigFile(TargetT& target, const char* path, ErrorCallbackT errorCallback) {
+    const std::shared_ptr<detail::MappedFile> file = detail::MappedFile::open(path);
+    if (!file) {
+        return reportError(errorCallback, ErrorCode::ConfigFileError, path, path, "Cannot read config file {}", path);
+    }
+    target.retainFile(file);
+    ConfigFileReader reader(*file);
+    ConfigFileReader::Entry entry;
+    // Names of keys in sections are built here, keys outside of sections are looked up in place
+    std::string sectionKey;
+    for (;;) {
+        PhaseTimer tokenizeTimer(target.stats, &ParseStats::tokenizeTime);
+        const bool found = reader.next(entry);
+        tokenizeTimer.stop();
+        if (!found) {
+            break;
+        }
+        countArgument(target.stats);
+        std::string_view name = entry.key;
+        if (!reader.section().empty()) {
+            sectionKey.assign(reader.section());
+            sectionKey.push_back('.');
+            sectionKey.append(entry.key);
+            name = sectionKey;
+        }
+        const ErrorCode code = setParam(target, name, entry.value, entry.input, errorCallback);
+        if (code != ErrorCode::Success) {
+            return code;
+        }
+    }
+    if (reader.hasInvalidLine()) {
+        return reportError(
+            errorCallback,
+            ErrorCode::ConfigFileError,
+            path,
+            path,
+            "Config file {} has invalid line {}. Expected key=value, key or [section]",
+            path,
+            reader.line()
+        );
+    }
+    return ErrorCode::Success;
 }
 
-void CommandLineArgs::freeMem() {
-	freeValues();
-	paramInfo.clear();
+/// @brief Parse one argument from argv or from a response file
+/// @param[in] depth The depth of the response file which contains the argument, 0 for argv
+template<typename TargetT>
+ErrorCode parseToken(
+    TargetT& target,
+    const char* arg,
+    const int depth,
+    ArgumentState<TargetT>& state,
+    ErrorCallbackT errorCallback
+) {
+    if (state.pendingInput != nullptr) {
+        // The whole argument is the value, even if it starts with - or @
+        countArgument(target.stats);
+        const char* const input = std::exchange(state.pendingInput, nullptr);
+        return storeValue(target, state.pending, state.pendingName, arg, input, errorCallback);
+    }
+    if constexpr (TargetT::supportsPositionals) {
+        if (target.acceptsPositionals()) {
+            if (state.afterTerminator) {
+                return target.addPositional(arg);
+            }
+            if (std::strcmp(arg, "--") == 0) {
+                state.afterTerminator = true;
+                return ErrorCode::Success;
+            }
+        }
+    }
+    return arg[0] == '@' ?
+        parseResponseFile(target, arg, depth + 1, state, errorCallback) :
+        parseArgument(target, arg, state, errorCallback);
 }
 
-std::string CommandLineArgs::getDescription() const {
-    if (!descriptionGenerated) {
-        description = std::format("Usage: {}", programName);
-        if (!paramInfo.empty()) {
-            description.append(" [OPTIONS]\nOptions:\n");
-            for (auto it : paramInfo) {
-                const std::string& required = it.second.required ? "[REQUIRED]" : "";
-                description += std::format("\t --{}, {} {}\n", it.first, it.second.description, required);
+/// @brief Walk argv and check each argument against the schema of TargetT. Arguments starting with @
+/// are response files, their arguments are parsed as if they were in argv at that place.
+template<typename TargetT>
+ErrorCode parseArguments(TargetT& target, const int argc, char** argv, ErrorCallbackT errorCallback) {
+    ArgumentState<TargetT> state;
+    for (int i = 1; i < argc; ++i) {
+        const ErrorCode code = parseToken(target, argv[i], 0, state, errorCallback);
+        if (code != ErrorCode::Success) {
+            return code;
+        }
+    }
+    const ErrorCode code = state.finish(target, errorCallback);
+    if (code != ErrorCode::Success) {
+        return code;
+    }
+    PhaseTimer requiredCheckTimer(target.stats, &ParseStats::requiredCheckTime);
+    return target.checkRequired(errorCallback);
+}
+
+/// @brief Parse a command line passed as one string. It is split in place and its arguments are parsed
+/// the same as the arguments in argv.
+template<typename TargetT>
+ErrorCode parseCommandLine(
+    TargetT& target,
+    const std::shared_ptr<detail::MappedFile>& commandLine,
+    ErrorCallbackT errorCallback
+) {
+    target.retainFile(commandLine);
+    ArgumentState<TargetT> state;
+    bool unclosedQuote = false;
+    ErrorCode code = parseTokens(target, *commandLine, 0, state, unclosedQuote, errorCallback);
+    if (code != ErrorCode::Success) {
+        return code;
+    }
+    if (unclosedQuote) {
+        return reportError(errorCallback, ErrorCode::UnclosedQuote, "", "", "Command line has a quote which is not closed");
+    }
+    code = state.finish(target, errorCallback);
+    if (code != ErrorCode::Success) {
+        return code;
+    }
+    PhaseTimer requiredCheckTimer(target.stats, &ParseStats::requiredCheckTime);
+    return target.checkRequired(errorCallback);
+}
+
+
+ErrorCode reportMissingParameter(std::string_view name, ErrorCallbackT errorCallback) {
+    return reportError(
+        errorCallback,
+        ErrorCode::MissingParameter,
+        name,
+        "",
+        "Required parameter {} cannot be found!",
+        name
+    );
+}
+
+/// @brief Call fn(i) for each i in [0, count) using up to threadCount threads, including the calling one.
+/// Returns after all calls are done.
+template<typename FnT>
+void parallelFor(const std::size_t count, unsigned threadCount, FnT&& fn) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // Items are taken in chunks from a shared counter, so threads which got cheap items
+    // take more work instead of waiting for the others.
+    const std::size_t chunkSize = std::max<std::size_t>(1, count / (std::size_t(threadCount) * 8));
+    std::atomic<std::size_t> next = 0;
+    auto worker = [&]() {
+        for (;;) {
+            const std::size_t begin = next.fetch_add(chunkSize, std::memory_order_relaxed);
+            if (begin >= count) {
+                return;
+            }
+            const std::size_t end = std::min(begin + chunkSize, count);
+            for (std::size_t i = begin; i < end; ++i) {
+                fn(i);
             }
         }
+    };
+
+    const std::size_t workers = std::min<std::size_t>(threadCount, (count + chunkSize - 1) / chunkSize);
+    std::vector<std::thread> threads;
+    threads.reserve(workers > 0 ? workers - 1 : 0);
+    for (std::size_t i = 1; i < workers; ++i) {
+        threads.emplace_back(worker);
+    }
+    // The calling thread is one of the workers
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+/// @brief Appends data to the blob written by CommandLineArgs::serialize. Parts are addressed by offsets,
+/// because the buffer moves while it grows.
+class BlobWriter {
+public:
+    /// @brief Append zeroed space
+    /// @return Offset of the space
+    uint64_t allocate(const std::size_t size, const std::size_t alignment) {
+        const std::size_t offset = (data.size() + alignment - 1) / alignment * alignment;
+        data.resize(offset + size);
+        return offset;
+    }
+
+    uint64_t append(const void* bytes, const std::size_t size, const std::size_t alignment) {
+        const uint64_t offset = allocate(size, alignment);
+        if (size) {
+            std::memcpy(data.data() + offset, bytes, size);
+        }
+        return offset;
+    }
+
+    detail::BlobString appendText(const std::string_view text) {
+        return {append(text.data(), text.size(), 1), text.size()};
+    }
+
+    /// @brief Append an array of BlobString for the strings and the characters of the strings
+    /// @return Offset of the array
+    uint64_t appendTexts(const std::span<const std::string_view> texts) {
+        std::vector<detail::BlobString> strings;
+        strings.reserve(texts.size());
+        for (const std::string_view text : texts) {
+            strings.push_back(appendText(text));
+        }
+        return append(strings.data(), strings.size() * sizeof(detail::BlobString), alignof(detail::BlobString));
+    }
+
+    /// @brief Copy a part which was already allocated
+    template<typename T>
+    void write(const uint64_t offset, const T& value) {
+        std::memcpy(data.data() + offset, &value, sizeof(T));
+    }
+
+    std::vector<std::byte> data;
+};
+
+/// @brief Check that [offset, offset + count * size) is inside a blob of blobSize bytes and that offset is aligned
+bool inBlob(const uint64_t blobSize, const uint64_t offset, const uint64_t count, const std::size_t size, const std::size_t alignment) {
+    return offset % alignment == 0 && offset <= blobSize && count <= (blobSize - offset) / size;
+}
+
+/// @brief Placeholder of the value shown in the help after the name of a parameter, empty for flags
+std::string_view valuePlaceholder(const CommandLineArgs::Type type) {
+    switch (type) {
+        case CommandLineArgs::Type::Int:
+        case CommandLineArgs::Type::Int64:
+        case CommandLineArgs::Type::UInt64: return "<int>";
+        case CommandLineArgs::Type::Double: return "<number>";
+        case CommandLineArgs::Type::Size: return "<size>";
+        case CommandLineArgs::Type::String: return "<string>";
+        case CommandLineArgs::Type::IntList:
+        case CommandLineArgs::Type::StringList: return "<list>";
+        case CommandLineArgs::Type::Custom: return "<value>";
+        case CommandLineArgs::Type::Flag: return "";
+    }
+    return "";
+}
+
+/// @brief Append the words of text in lines of at most width characters, 0 means one line. Lines after the
+/// first start with indent spaces. Words longer than a line are not split.
+/// @param[in] lineLength Length of the text already in the current line
+/// @return Length of the text in the last line
+std::size_t appendWrapped(
+    std::pmr::string& out,
+    std::string_view text,
+    const std::size_t indent,
+    const std::size_t width,
+    std::size_t lineLength = 0
+) {
+    while (!text.empty()) {
+        const std::size_t end = std::min(text.find(' '), text.size());
+        const std::string_view word = text.substr(0, end);
+        text.remove_prefix(std::min(end + 1, text.size()));
+        if (word.empty()) {
+            continue;
+        }
+        if (lineLength != 0 && width != 0 && lineLength + 1 + word.size() > width) {
+            out.push_back('\n');
+            out.append(indent, ' ');
+            lineLength = 0;
+        } else if (lineLength != 0) {
+            out.push_back(' ');
+            ++lineLength;
+        }
+        out.append(word);
+        lineLength += word.size();
+    }
+    return lineLength;
+}
+
+/// @brief Option of a parser as written in a completion script
+struct CompletionOption {
+    std::string_view name;
+    std::string_view description;
+    char shortName;
+    bool takesValue;
+    /// Lists can be passed more than once
+    bool repeatable;
+    /// The value is completed as a file name
+    bool completesFiles;
+};
+
+/// @brief Parser or subcommand whose options are completed
+struct CompletionCommand {
+    std::string_view name;
+    std::string_view description;
+    std::vector<CompletionOption> options;
+};
+
+/// @brief Append text in single quotes for a POSIX shell, ' is written as '\''
+void appendQuoted(std::string& out, const std::string_view text) {
+    out.push_back('\'');
+    for (const char c : text) {
+        if (c == '\'') {
+            out.append("'\\''");
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('\'');
+}
+
+/// @brief Append the bash code which completes the options of one command and the names of subcommands
+void appendBashOptions(
+    std::string& script,
+    const std::vector<CompletionOption>& options,
+    const std::span<const CompletionCommand> subcommands,
+    const std::string_view indent
+) {
+    // Values are completed as file names or not at all, depending on the previous word
+    for (const bool files : {true, false}) {
+        std::string patterns;
+        for (const CompletionOption& option : options) {
+            if (!option.takesValue || option.completesFiles != files) {
+                continue;
+            }
+            if (!patterns.empty()) {
+                patterns.push_back('|');
+            }
+            appendQuoted(patterns, std::format("--{}", option.name));
+            if (option.shortName != '\0') {
+                patterns.push_back('|');
+                appendQuoted(patterns, std::format("-{}", option.shortName));
+            }
+        }
+        if (patterns.empty()) {
+            continue;
+        }
+        std::format_to(
+            std::back_inserter(script),
+            "{}case \"$prev\" in {}) {}return ;; esac\n",
+            indent,
+            patterns,
+            files ? "COMPREPLY=($(compgen -f -- \"$cur\")); " : ""
+        );
+    }
+    std::string words;
+    for (const CompletionOption& option : options) {
+        std::format_to(std::back_inserter(words), "{}--{}", words.empty() ? "" : " ", option.name);
+        if (option.shortName != '\0') {
+            std::format_to(std::back_inserter(words), " -{}", option.shortName);
+        }
+    }
+    for (const CompletionCommand& subcommand : subcommands) {
+        std::format_to(std::back_inserter(words), "{}{}", words.empty() ? "" : " ", subcommand.name);
+    }
+    script.append(indent).append("COMPREPLY=($(compgen -W ");
+    appendQuoted(script, words);
+    script.append(" -- \"$cur\"))\n");
+}
+
+std::string bashCompletion(
+    const std::string_view command,
+    const std::string_view function,
+    const std::vector<CompletionOption>& options,
+    const std::span<const CompletionCommand> subcommands
+) {
+    std::string script = std::format("# bash completion for {}\n{}() {{\n", command, function);
+    script.append("    local cur=\"${COMP_WORDS[COMP_CWORD]}\" prev=\"${COMP_WORDS[COMP_CWORD-1]}\"\n");
+    if (subcommands.empty()) {
+        appendBashOptions(script, options, subcommands, "    ");
+    } else {
+        // The first word which is not an option or the value of an option is the subcommand
+        std::string values;
+        for (const CompletionOption& option : options) {
+            if (!option.takesValue) {
+                continue;
+            }
+            if (!values.empty()) {
+                values.push_back('|');
+            }
+            appendQuoted(values, std::format("--{}", option.name));
+            if (option.shortName != '\0') {
+                values.push_back('|');
+                appendQuoted(values, std::format("-{}", option.shortName));
+            }
+        }
+        std::string names;
+        for (const CompletionCommand& subcommand : subcommands) {
+            if (!names.empty()) {
+                names.push_back('|');
+            }
+            appendQuoted(names, subcommand.name);
+        }
+        script.append("    local command=\"\" i\n");
+        script.append("    for ((i = 1; i < COMP_CWORD; i++)); do\n");
+        script.append("        case \"${COMP_WORDS[i]}\" in\n");
+        if (!values.empty()) {
+            std::format_to(std::back_inserter(script), "            {}) ((i++)) ;;\n", values);
+        }
+        std::format_to(std::back_inserter(script), "            {}) command=\"${{COMP_WORDS[i]}}\"; break ;;\n", names);
+        script.append("        esac\n    done\n    case \"$command\" in\n        '')\n");
+        appendBashOptions(script, options, subcommands, "            ");
+        script.append("            ;;\n");
+        for (const CompletionCommand& subcommand : subcommands) {
+            script.append("        ");
+            appendQuoted(script, subcommand.name);
+            script.append(")\n");
+            appendBashOptions(script, subcommand.options, {}, "            ");
+            script.append("            ;;\n");
+        }
+        script.append("    esac\n");
+    }
+    script.append("}\ncomplete -F ").append(function).push_back(' ');
+    appendQuoted(script, command);
+    script.push_back('\n');
+    return script;
+}
+
+/// @brief Append the arguments of zsh _arguments which describe the options, one per line
+void appendZshOptions(std::string& script, const std::vector<CompletionOption>& options, const std::string_view indent) {
+    const auto appendEscaped = [](std::string& out, const std::string_view text) {
+        for (const char c : text) {
+            if (c == '\\' || c == '[' || c == ']' || c == ':') {
+                out.push_back('\\');
+            }
+            out.push_back(c);
+        }
+    };
+    for (const CompletionOption& option : options) {
+        script.append(" \\\n").append(indent);
+        // [description]:name:action
+        std::string suffix = "[";
+        appendEscaped(suffix, option.description);
+        suffix.push_back(']');
+        if (option.takesValue) {
+            suffix.push_back(':');
+            appendEscaped(suffix, option.name);
+            suffix.append(option.completesFiles ? ":_files" : ": ");
+        }
+        const std::string longName = std::format("--{}{}", option.name, option.takesValue ? "=" : "");
+        if (option.shortName == '\0') {
+            appendQuoted(script, std::format("{}{}{}", option.repeatable ? "*" : "", longName, suffix));
+            continue;
+        }
+        // -j+ takes the value attached or in the next word, the group makes -j and --jobs exclusive
+        appendQuoted(script, option.repeatable ? std::string("*") : std::format("(-{} --{})", option.shortName, option.name));
+        script.push_back('{');
+        appendQuoted(script, std::format("-{}{}", option.shortName, option.takesValue ? "+" : ""));
+        script.push_back(',');
+        appendQuoted(script, longName);
+        script.push_back('}');
+        appendQuoted(script, suffix);
+    }
+}
+
+std::string zshCompletion(
+    const std::string_view command,
+    const std::string_view function,
+    const std::vector<CompletionOption>& options,
+    const std::span<const CompletionCommand> subcommands
+) {
+    std::string script = std::format("#compdef {}\n# zsh completion for {}\n{}() {{\n", command, command, function);
+    if (subcommands.empty()) {
+        script.append("    _arguments -s -S");
+        appendZshOptions(script, options, "        ");
+        script.push_back('\n');
+    } else {
+        script.append("    local state\n    _arguments -s -S");
+        appendZshOptions(script, options, "        ");
+        script.append(" \\\n        '1: :->command' \\\n        '*:: :->args' && return\n");
+        script.append("    case $state in\n        command)\n            local -a commands\n            commands=(");
+        for (const CompletionCommand& subcommand : subcommands) {
+            script.append("\n                ");
+            std::string entry;
+            for (const char c : subcommand.name) {
+                if (c == ':') {
+                    entry.push_back('\\');
+                }
+                entry.push_back(c);
+            }
+            entry.push_back(':');
+            entry.append(subcommand.description);
+            appendQuoted(script, entry);
+        }
+        script.append("\n            )\n            _describe command commands ;;\n");
+        script.append("        args)\n            case $words[1] in\n");
+        for (const CompletionCommand& subcommand : subcommands) {
+            script.append("                ");
+            appendQuoted(script, subcommand.name);
+            script.push_back(')');
+            if (!subcommand.options.empty()) {
+                script.append(" _arguments -s -S");
+                appendZshOptions(script, subcommand.options, "                    ");
+            }
+            script.append(" ;;\n");
+        }
+        script.append("            esac ;;\n    esac\n");
+    }
+    script.append("}\n");
+    // Loaded from fpath the file is the body of the completion function, loaded with source it registers it
+    std::format_to(
+        std::back_inserter(script),
+        "if [[ \"${{zsh_eval_context[-1]}}\" == loadautofunc ]]; then\n    {} \"$@\"\nelse\n    compdef {} ",
+        function,
+        function
+    );
+    appendQuoted(script, command);
+    script.append("\nfi\n");
+    return script;
+}
+
+} // namespace
+
+struct CommandLineArgs::Validations {
+    struct Value {
+        ParamId id;
+        /// Points into argv, into a response file or into a command line, null terminated
+        const char* value;
+    };
+
+    /// Indexed by ParamId
+    const ValidatorT* validators;
+    /// Values of parameters which have a validator, in the order they were passed
+    std::vector<Value> values;
+    /// Response files and command lines which the values point into, kept until the validators are done
+    std::vector<std::shared_ptr<const detail::MappedFile>> files;
+};
+
+CommandLineArgs::ErrorCode CommandLineArgs::parse(const int argc, char** argv, ErrorCallbackT errorCallback) {
+    return parse(argc, argv, Sources{}, errorCallback);
+}
+
+CommandLineArgs::ErrorCode CommandLineArgs::parse(
+    const int argc,
+    char** argv,
+    const Sources& sources,
+    ErrorCallbackT errorCallback
+) {
+    // argv[0] is the name of the program (exe), that is why the parsing starts from 1
+    setProgramName(argv[0]);
+    return parseArgv(argc, argv, sources, errorCallback);
+}
+
+CommandLineArgs::ErrorCode CommandLineArgs::parseArgv(
+    const int argc,
+    char** argv,
+    const Sources& sources,
+    ErrorCallbackT errorCallback
+) {
+    validationErrors.clear();
+    // With subcommands the parameters of this parser end at the name of the subcommand
+    int ownArgc = argc;
+    if (!subcommands.list.empty()) {
+        subcommands.active = -1;
+        ownArgc = 1;
+        while (ownArgc < argc && (argv[ownArgc][0] == '-' || argv[ownArgc][0] == '@')) {
+            // The value of --name value is not the name of the subcommand
+            ownArgc += takesNextArgument(*paramTable, argv[ownArgc]) && ownArgc + 1 < argc ? 2 : 1;
+        }
+    }
+    const ErrorCode code = parseValues(Input{ownArgc, argv, nullptr}, sources, errorCallback);
+    if (code != ErrorCode::Success || subcommands.list.empty()) {
+        return code;
+    }
+    return parseSubcommand(argc - ownArgc, argv + ownArgc, errorCallback);
+}
+
+CommandLineArgs::ErrorCode CommandLineArgs::parse(const std::string_view commandLine, ErrorCallbackT errorCallback) {
+    validationErrors.clear();
+    subcommands.active = -1;
+    return parseValues(Input{0, nullptr, detail::MappedFile::copy(commandLine)}, Sources{}, errorCallback);
+}
+
+CommandLineArgs::ErrorCode CommandLineArgs::parseValues(
+    const Input& input,
+    const Sources& sources,
+    ErrorCallbackT errorCallback
+) {
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+    ParseStats stats;
+    const ArenaResource& arena = valueStore->arena;
+    const uint64_t allocationCount = arena.allocationCount();
+    const uint64_t allocatedBytes = arena.allocatedBytes();
+    const ErrorCode code = parseAndValidate(valueStore->values, bindings.data(), &stats, &validationErrors, sources, input, errorCallback);
+    stats.allocationCount = arena.allocationCount() - allocationCount;
+    stats.allocatedBytes = arena.allocatedBytes() - allocatedBytes;
+    recordParse(stats);
+    return code;
+#else
+    return parseAndValidate(valueStore->values, bindings.data(), nullptr, &validationErrors, sources, input, errorCallback);
+#endif
+}
+
+CommandLineArgs::ErrorCode CommandLineArgs::parseSubcommand(const int argc, char** argv, ErrorCallbackT errorCallback) {
+    if (argc == 0) {
+        return reportError(errorCallback, ErrorCode::UnknownSubcommand, "", "", "Subcommand is missing");
+    }
+    const std::string_view name(argv[0]);
+    const auto it = subcommands.ids.find(name);
+    if (it == subcommands.ids.end()) {
+        return reportError(errorCallback, ErrorCode::UnknownSubcommand, name, argv[0], "Unknown subcommand {}", name);
+    }
+    Subcommand& subcommand = subcommands.list[it->second];
+    if (!subcommand.args) {
+        auto args = std::make_unique<CommandLineArgs>(resource, stringStorage);
+        const ErrorCode code = subcommand.factory(*args);
+        if (code != ErrorCode::Success) {
+            return code;
+        }
+        // Help of the subcommand shows the whole command e.g. "tool build"
+        args->setProgramName(std::format("{} {}", std::string_view(programName), name));
+        subcommand.args = std::move(args);
+    }
+    subcommands.active = int(it->second);
+    return subcommand.args->parseArgv(argc, argv, Sources{}, errorCallback);
+}
+
+void CommandLineArgs::setProgramName(const std::string_view name) {
+    if (programName == name) {
+        return;
+    }
+    programName = name;
+    descriptionGenerated = false;
+    for (Subcommand& subcommand : subcommands.list) {
+        if (subcommand.args) {
+            subcommand.args->setProgramName(std::format("{} {}", name, std::string_view(subcommand.name)));
+        }
+    }
+}
+
+CommandLineArgs* CommandLineArgs::getSubcommand() {
+    return subcommands.active == -1 ? nullptr : subcommands.list[subcommands.active].args.get();
+}
+
+const CommandLineArgs* CommandLineArgs::getSubcommand() const {
+    return subcommands.active == -1 ? nullptr : subcommands.list[subcommands.active].args.get();
+}
+
+void CommandLineArgs::setPositionalCallback(PositionalCallbackT callback) {
+    positionals.callback = std::move(callback);
+}
+
+void CommandLineArgs::setCollectPositionals(const bool collect) {
+    positionals.collect = collect;
+}
+
+std::string_view CommandLineArgs::getSubcommandName() const {
+    return subcommands.active == -1 ? std::string_view() : std::string_view(subcommands.list[subcommands.active].name);
+}
+
+CommandLineArgs::ErrorCode CommandLineArgs::parse(
+    const int argc,
+    char** argv,
+    std::shared_ptr<const ParsedArgs>& out,
+    ErrorCallbackT errorCallback,
+    std::vector<ValidationError>* validationErrors
+) const {
+    return parse(argc, argv, Sources{}, out, errorCallback, validationErrors);
+}
+
+CommandLineArgs::ErrorCode CommandLineArgs::parse(
+    const int argc,
+    char** argv,
+    const Sources& sources,
+    std::shared_ptr<const ParsedArgs>& out,
+    ErrorCallbackT errorCallback,
+    std::vector<ValidationError>* validationErrors
+) const {
+    return parseSnapshot(Input{argc, argv, nullptr}, sources, out, errorCallback, validationErrors);
+}
+
+CommandLineArgs::ErrorCode CommandLineArgs::parse(
+    const std::string_view commandLine,
+    std::shared_ptr<const ParsedArgs>& out,
+    ErrorCallbackT errorCallback,
+    std::vector<ValidationError>* validationErrors
+) const {
+    return parseSnapshot(Input{0, nullptr, detail::MappedFile::copy(commandLine)}, Sources{}, out, errorCallback, validationErrors);
+}
+
+CommandLineArgs::ErrorCode CommandLineArgs::parseSnapshot(
+    const Input& input,
+    const Sources& sources,
+    std::shared_ptr<const ParsedArgs>& out,
+    ErrorCallbackT errorCallback,
+    std::vector<ValidationError>* validationErrors
+) const {
+    if (validationErrors) {
+        validationErrors->clear();
+    }
+    ParamValues values(*paramTable, stringStorage, std::pmr::get_default_resource());
+    // The parser is shared between threads, bound variables are written only by the non const parse
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+    ParseStats stats;
+    const ErrorCode code = parseAndValidate(values, nullptr, &stats, validationErrors, sources, input, errorCallback);
+    recordParse(stats);
+#else
+    const ErrorCode code = parseAndValidate(values, nullptr, nullptr, validationErrors, sources, input, errorCallback);
+#endif
+    if (code == ErrorCode::Success) {
+        out = std::shared_ptr<const ParsedArgs>(new ParsedArgs(paramTable, std::move(values)));
+    } else {
+        out.reset();
+    }
+    return code;
+}
+
+std::vector<CommandLineArgs::BatchResult> CommandLineArgs::parseBatch(
+    std::span<const Arguments> inputs,
+    unsigned threadCount,
+    ErrorCallbackT errorCallback
+) const {
+    std::vector<BatchResult> results(inputs.size());
+    parallelFor(inputs.size(), threadCount, [&](std::size_t i) {
+        BatchResult& result = results[i];
+        result.code = parse(inputs[i].numArgs, inputs[i].args, result.args, errorCallback, &result.validationErrors);
+    });
+    return results;
+}
+
+CommandLineArgs::ErrorCode CommandLineArgs::parseAndValidate(
+    ParamValues& values,
+    void* const* bindings,
+    ParseStats* stats,
+    std::vector<ValidationError>* errors,
+    const Sources& sources,
+    const Input& input,
+    ErrorCallbackT errorCallback
+) const {
+    if (validatorCount == 0) {
+        return parseInto(*paramTable, values, stringStorage, bindings, stats, positionals, nullptr, sources, input, errorCallback);
+    }
+    Validations validations{validators.data(), {}, {}};
+    const ErrorCode code = parseInto(*paramTable, values, stringStorage, bindings, stats, positionals, &validations, sources, input, errorCallback);
+    if (code != ErrorCode::Success) {
+        return code;
+    }
+    // Validators are independent, each one writes only its own message. The results are reported after
+    // all threads are joined, so that errors come in the order of the arguments.
+    const std::size_t count = validations.values.size();
+    std::vector<std::string> messages(count);
+    std::unique_ptr<bool[]> rejected(new bool[count]());
+    const unsigned threadCount = count < parallelValidationThreshold ? 1 : validationThreads;
+    parallelFor(count, threadCount, [&](std::size_t i) {
+        const Validations::Value& value = validations.values[i];
+        rejected[i] = !validators[value.id](value.value, messages[i]);
+    });
+
+    ErrorCode result = ErrorCode::Success;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!rejected[i]) {
+            continue;
+        }
+        const Validations::Value& value = validations.values[i];
+        const std::string_view name = paramTable->names[value.id];
+        result = reportError(
+            errorCallback,
+            ErrorCode::ValidationFailed,
+            name,
+            value.value,
+            "Parameter {} has invalid value {}. {}",
+            name,
+            value.value,
+            messages[i]
+        );
+        if (errors) {
+            errors->push_back(ValidationError{value.id, value.value, std::move(messages[i])});
+        }
+    }
+    return result;
+}
+
+CommandLineArgs::ErrorCode CommandLineArgs::setValidator(const ParamId id, ValidatorT validator) {
+    if (id >= validators.size()) {
+        return ErrorCode::UnknownParameter;
+    }
+    validatorCount = validatorCount - bool(validators[id]) + bool(validator);
+    validators[id] = std::move(validator);
+    return ErrorCode::Success;
+}
+
+void CommandLineArgs::setValidationThreads(const unsigned threadCount) {
+    validationThreads = threadCount;
+}
+
+CommandLineArgs::ErrorCode CommandLineArgs::setShortName(const ParamId id, const char shortName) {
+    if (id >= paramTable->names.size()) {
+        return ErrorCode::UnknownParameter;
+    }
+    if (shortName != '\0' && !std::isalnum(static_cast<unsigned char>(shortName))) {
+        return ErrorCode::WrongParamFormat;
+    }
+    const ParamId owner = shortName == '\0' ? invalidParamId : paramTable->shortIds[uint8_t(shortName)];
+    if (owner != invalidParamId && owner != id) {
+        return ErrorCode::ParameterExists;
+    }
+    ParamTable& table = mutableTable();
+    descriptionGenerated = false;
+    const char previous = table.shortNames[id];
+    if (previous != '\0') {
+        table.shortIds[uint8_t(previous)] = invalidParamId;
+    }
+    table.shortNames[id] = shortName;
+    if (shortName != '\0') {
+        table.shortIds[uint8_t(shortName)] = id;
+    }
+    return ErrorCode::Success;
+}
+
+bool CommandLineArgs::takesNextArgument(const ParamTable& table, const char* arg) {
+    if (arg[0] != '-' || arg[1] == '\0') {
+        return false;
+    }
+    if (arg[1] == '-') {
+        const std::string_view name(arg + 2);
+        if (name.find('=') != std::string_view::npos) {
+            return false;
+        }
+        const ParamId id = findParamId(table, name);
+        return id != invalidParamId && table.types[id] != Type::Flag;
+    }
+    // Same as parseShortOptions, the first option which takes a value ends the bundle
+    for (const char* it = arg + 1; *it != '\0'; ++it) {
+        const ParamId id = table.shortIds[uint8_t(*it)];
+        if (id == invalidParamId) {
+            return false;
+        }
+        if (table.types[id] != Type::Flag) {
+            return it[1] == '\0';
+        }
+    }
+    return false;
+}
+
+struct CommandLineArgs::ParseTarget {
+    static constexpr bool supportsLists = true;
+    static constexpr bool supportsPositionals = true;
+    static constexpr bool supportsValidators = true;
+    static constexpr bool supportsSources = true;
+    static constexpr bool supportsCustomTypes = true;
+    static constexpr bool supportsShortNames = true;
+
+    struct Param {
+        explicit operator bool() const { return id != invalidParamId; }
+        Type type() const { return table->types[id]; }
+        const ParamTable* table = nullptr;
+        ParamId id = invalidParamId;
+    };
+
+    Param find(std::string_view name) const {
+        return {&table, findParamId(table, name)};
+    }
+
+    Param findShort(const char shortName) const {
+        return {&table, table.shortIds[uint8_t(shortName)]};
+    }
+
+    /// @brief Variable bound to the parameter or null
+    template<typename T>
+    T* binding(const Param& param) const {
+        return bindings ? static_cast<T*>(bindings[param.id]) : nullptr;
+    }
+
+    template<typename T>
+    void setValue(const Param& param, T value) {
+        if (T* destination = binding<T>(param)) {
+            *destination = value;
+        }
+        getColumn<T>(values)[table.columns[param.id]] = value;
+        markPresent(param);
+    }
+
+    void markPresent(const Param& param) {
+        values.present.set(param.id);
+        values.sources[param.id] = source;
+    }
+
+    /// @brief Check if a list parameter has items from an earlier source, which must be replaced
+    bool replacesList(const Param& param) const {
+        return values.present.test(param.id) && values.sources[param.id] != source;
+    }
+
+    void setString(const Param& param, std::string_view value) {
+        if (std::string* destination = binding<std::string>(param)) {
+            destination->assign(value);
+        }
+        const uint32_t column = table.columns[param.id];
+        if (stringStorage == StringStorage::View) {
+            values.stringViews[column] = value;
+        } else {
+            values.strings[column] = value;
+        }
+        markPresent(param);
+    }
+
+    void setFlag(const Param& param) {
+        if (bool* destination = binding<bool>(param)) {
+            *destination = true;
+        }
+        markPresent(param);
+    }
+
+    /// @brief Convert the value into the stored object. On error the parameter is not marked present.
+    bool setCustom(const Param& param, std::string_view value) {
+        detail::CustomValue& custom = values.customs[table.columns[param.id]];
+        if (!custom.parse(value)) {
+            return false;
+        }
+        if (void* destination = bindings ? bindings[param.id] : nullptr) {
+            custom.assignTo(destination);
+        }
+        markPresent(param);
+        return true;
+    }
+
+    bool flagsTakeValue() const {
+        return source != Source::CommandLine;
+    }
+
+    void clearFlag(const Param& param) {
+        if (bool* destination = binding<bool>(param)) {
+            *destination = false;
+        }
+        values.present.reset(param.id);
+        values.sources[param.id] = source;
+    }
+
+    /// @brief Append the items of value to the list. On error the list is left as it was.
+    bool appendIntList(const Param& param, std::string_view value) {
+        IntList& list = values.intLists[table.columns[param.id]];
+        if (replacesList(param)) {
+            list.items.clear();
+        }
+        const std::size_t oldSize = list.items.size();
+        reserveAdditional(list.items, countListItems(value));
+        const bool parsed = forEachListItem(value, [&](std::string_view item) {
+            int res;
+            if (!parseInteger(item, res)) {
+                return false;
+            }
+            list.items.push_back(res);
+            return true;
+        });
+        if (parsed) {
+            markPresent(param);
+            if (std::vector<int>* destination = binding<std::vector<int>>(param)) {
+                // Items from the previous arguments are already there, defaults are replaced
+                destination->resize(oldSize);
+                destination->insert(destination->end(), list.items.begin() + oldSize, list.items.end());
+            }
+        } else {
+            list.items.resize(oldSize);
+        }
+        list.view = list.items;
+        return parsed;
+    }
+
+    bool acceptsPositionals() const {
+        return positionals.callback || positionals.collect;
+    }
+
+    ErrorCode addPositional(std::string_view arg) {
+        if (positionals.collect) {
+            StringList& list = values.positionals;
+            const char* oldBuffer = list.buffer.data();
+            const std::size_t oldSize = list.items.size();
+            reserveAdditional(list.items, 1);
+            if (stringStorage == StringStorage::Copy) {
+                reserveAdditional(list.ends, 1);
+                reserveAdditional(list.buffer, arg.size());
+                list.buffer.append(arg);
+                list.ends.push_back(list.buffer.size());
+                list.items.emplace_back();
+            } else {
+                list.items.push_back(arg);
+            }
+            list.updateItems(list.buffer.data() == oldBuffer ? oldSize : 0);
+        }
+        return positionals.callback ? positionals.callback(arg) : ErrorCode::Success;
+    }
+
+    /// @brief Append the items of value to the list. On error the list is left as it was.
+    bool appendStringList(const Param& param, std::string_view value) {
+        StringList& list = values.stringLists[table.columns[param.id]];
+        if (replacesList(param)) {
+            list.items.clear();
+            list.ends.clear();
+            list.buffer.clear();
+        }
+        const std::size_t oldSize = list.items.size();
+        const std::size_t oldBufferSize = list.buffer.size();
+        const char* oldBuffer = list.buffer.data();
+        const std::size_t count = countListItems(value);
+        reserveAdditional(list.items, count);
+        if (stringStorage == StringStorage::Copy) {
+            reserveAdditional(list.ends, count);
+            reserveAdditional(list.buffer, value.size());
+        }
+        const bool parsed = forEachListItem(value, [&](std::string_view item) {
+            if (item.empty()) {
+                return false;
+            }
+            if (stringStorage == StringStorage::Copy) {
+                // The view is set by updateItems, once the buffer no longer grows
+                list.buffer.append(item);
+                list.ends.push_back(list.buffer.size());
+                list.items.emplace_back();
+            } else {
+                list.items.push_back(item);
+            }
+            return true;
+        });
+        if (parsed) {
+            markPresent(param);
+        } else {
+            list.items.resize(oldSize);
+            list.ends.resize(std::min(list.ends.size(), oldSize));
+            list.buffer.resize(oldBufferSize);
+        }
+        // If the buffer was reallocated the views to the previous items point to freed memory
+        list.updateItems(list.buffer.data() == oldBuffer ? oldSize : 0);
+        if (parsed) {
+            if (std::vector<std::string>* destination = binding<std::vector<std::string>>(param)) {
+                destination->resize(oldSize);
+                destination->insert(destination->end(), list.items.begin() + oldSize, list.items.end());
+            }
+        }
+        return parsed;
+    }
+
+    void retainFile(std::shared_ptr<const detail::MappedFile> file) {
+        if (validations) {
+            validations->files.push_back(file);
+        }
+        // Copied strings do not point into the file, it can be unmapped after parsing
+        if (stringStorage == StringStorage::View) {
+            values.files.push_back(std::move(file));
+        }
+    }
+
+    void addValidation(const Param& param, const char* value) {
+        if (validations && validations->validators[param.id]) {
+            validations->values.push_back({param.id, value});
+        }
+    }
+
+    /// @brief Set each parameter which has an environment variable, see CommandLineArgs::Sources
+    ErrorCode parseEnvironment(const char* prefix, ErrorCallbackT errorCallback) {
+        std::string variable(prefix);
+        const std::size_t prefixSize = variable.size();
+        for (const std::pmr::string& name : table.names) {
+            variable.resize(prefixSize);
+            for (const char c : name) {
+                const unsigned char u = static_cast<unsigned char>(c);
+                variable.push_back(std::isalnum(u) ? char(std::toupper(u)) : '_');
+            }
+            const char* value = std::getenv(variable.c_str());
+            if (value == nullptr) {
+                continue;
+            }
+            countArgument(stats);
+            const ErrorCode code = setParam(*this, name, value, value, errorCallback);
+            if (code != ErrorCode::Success) {
+                return code;
+            }
+        }
+        return ErrorCode::Success;
+    }
+
+    ErrorCode checkRequired(ErrorCallbackT errorCallback) const {
+        const int64_t missing = table.required.firstAndNot(values.present);
+        if (missing != -1) {
+            return reportMissingParameter(table.names[missing], errorCallback);
+        }
+        return ErrorCode::Success;
+    }
+
+    const ParamTable& table;
+    ParamValues& values;
+    const StringStorage stringStorage;
+    void* const* bindings;
+    ParseStats* const stats;
+    const Positionals& positionals;
+    Validations* const validations;
+    /// Source of the values which are currently parsed
+    Source source = Source::CommandLine;
+};
+
+CommandLineArgs::ErrorCode CommandLineArgs::parseInto(
+    const ParamTable& table,
+    ParamValues& values,
+    const StringStorage stringStorage,
+    void* const* bindings,
+    ParseStats* stats,
+    const Positionals& positionals,
+    Validations* validations,
+    const Sources& sources,
+    const Input& input,
+    ErrorCallbackT errorCallback
+) {
+    ParseTarget target{table, values, stringStorage, bindings, stats, positionals, validations};
+    if (sources.configFile) {
+        target.source = Source::ConfigFile;
+        const ErrorCode code = parseConfigFile(target, sources.configFile, errorCallback);
+        if (code != ErrorCode::Success) {
+            return code;
+        }
+    }
+    if (sources.environmentPrefix) {
+        target.source = Source::Environment;
+        const ErrorCode code = target.parseEnvironment(sources.environmentPrefix, errorCallback);
+        if (code != ErrorCode::Success) {
+            return code;
+        }
+    }
+    target.source = Source::CommandLine;
+    return input.commandLine ?
+        parseCommandLine(target, input.commandLine, errorCallback) :
+        parseArguments(target, input.numArgs, input.args, errorCallback);
+}
+
+namespace detail {
+
+namespace {
+
+struct StaticParseTarget {
+    static constexpr bool supportsLists = false;
+    static constexpr bool supportsPositionals = false;
+    static constexpr bool supportsValidators = false;
+    static constexpr bool supportsSources = false;
+    static constexpr bool supportsCustomTypes = false;
+    static constexpr bool supportsShortNames = false;
+
+    struct Param {
+        explicit operator bool() const { return index != -1; }
+        Type type() const { return schema->types[index]; }
+        const StaticSchemaRef* schema = nullptr;
+        int index = -1;
+    };
+
+    Param find(std::string_view name) const {
+        return {&schema, schema.find(name)};
+    }
+
+    void markPresent(int index) {
+        values.present[index / 64] |= uint64_t(1) << (index % 64);
+    }
+
+    template<typename T>
+    void setValue(const Param& param, T value) {
+        values.column<T>()[schema.columns[param.index]] = value;
+        markPresent(param.index);
+    }
+
+    void setString(const Param& param, std::string_view value) {
+        values.strings[schema.columns[param.index]] = value;
+        markPresent(param.index);
+    }
+
+    void setFlag(const Param& param) {
+        markPresent(param.index);
+    }
+
+    void retainFile(const std::shared_ptr<const MappedFile>&) {
+        // Strings are copied, nothing points into the file
+    }
+
+    ErrorCode checkRequired(ErrorCallbackT errorCallback) const {
+        for (std::size_t i = 0; i < schema.count; ++i) {
+            const bool isPresent = values.present[i / 64] & (uint64_t(1) << (i % 64));
+            if (schema.required[i] && !isPresent) {
+                return reportMissingParameter(schema.names[i], errorCallback);
+            }
+        }
+        return ErrorCode::Success;
+    }
+
+    const StaticSchemaRef& schema;
+    const StaticValuesRef& values;
+    ParseStats* const stats = nullptr;
+};
+
+} // namespace
+
+CommandLineArgs::ErrorCode parseStatic(
+    const StaticSchemaRef& schema,
+    const StaticValuesRef& values,
+    const int argc,
+    char** argv,
+    ErrorCallbackT errorCallback
+) {
+    StaticParseTarget target{schema, values};
+
+    return parseArguments(target, argc, argv, errorCallback);
+}
+
+} // namespace detail
+
+ArenaResource::~ArenaResource() {
+    release();
+}
+
+void ArenaResource::reset() {
+    current = head;
+    cursor = head ? reinterpret_cast<char*>(head + 1) : nullptr;
+    end = head ? reinterpret_cast<char*>(head) + head->size : nullptr;
+}
+
+void ArenaResource::release() {
+    while (head) {
+        Block* next = head->next;
+        upstream->deallocate(head, head->size, alignof(Block));
+        head = next;
+    }
+    current = nullptr;
+    cursor = end = nullptr;
+    totalCapacity = 0;
+}
+
+void* ArenaResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    for (;;) {
+        if (cursor) {
+            const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(cursor);
+            char* aligned = cursor + ((alignment - address % alignment) % alignment);
+            if (aligned <= end && std::size_t(end - aligned) >= bytes) {
+                cursor = aligned + bytes;
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+                ++allocations;
+                allocatedSize += bytes;
+#endif
+                return aligned;
+            }
+        }
+        // Blocks after the current one are left from before the last reset, reuse them
+        // before going to the upstream resource.
+        if (current && current->next) {
+            current = current->next;
+            cursor = reinterpret_cast<char*>(current + 1);
+            end = reinterpret_cast<char*>(current) + current->size;
+            continue;
+        }
+        const std::size_t needed = sizeof(Block) + bytes + alignment;
+        const std::size_t blockSize = std::max(nextBlockSize, needed);
+        Block* block = static_cast<Block*>(upstream->allocate(blockSize, alignof(Block)));
+        block->next = nullptr;
+        block->size = blockSize;
+        if (current) {
+            current->next = block;
+        } else {
+            head = block;
+        }
+        current = block;
+        cursor = reinterpret_cast<char*>(block + 1);
+        end = reinterpret_cast<char*>(block) + blockSize;
+        nextBlockSize = blockSize * 2;
+        totalCapacity += blockSize;
+    }
+}
+
+CommandLineArgs::ParamValues::ParamValues(
+    const ParamTable& table,
+    StringStorage storage,
+    std::pmr::memory_resource* resource
+) :
+    ints(resource),
+    int64s(resource),
+    uint64s(resource),
+    doubles(resource),
+    strings(resource),
+    stringViews(resource),
+    intLists(resource),
+    stringLists(resource),
+    customs(resource),
+    positionals(resource),
+    present(resource),
+    sources(resource),
+    files(resource)
+{
+    resize(table, storage);
+}
+
+void CommandLineArgs::ParamValues::resize(const ParamTable& table, StringStorage storage) {
+    ints.resize(table.intCount);
+    int64s.resize(table.int64Count);
+    uint64s.resize(table.uint64Count);
+    doubles.resize(table.doubleCount);
+    if (storage == StringStorage::Copy) {
+        strings.resize(table.stringCount);
+    } else {
+        stringViews.resize(table.stringCount);
+    }
+    intLists.resize(table.intListCount);
+    stringLists.resize(table.stringListCount);
+    // Each value is created with the operations of its type, thus the column cannot be resized
+    customs.reserve(table.customTypes.size());
+    for (std::size_t i = customs.size(); i < table.customTypes.size(); ++i) {
+        customs.emplace_back(table.customTypes[i]);
+    }
+    present.resize(table.names.size());
+    sources.resize(table.names.size(), Source::Default);
+}
+
+void CommandLineArgs::StringList::updateItems(std::size_t first) {
+    // ends is empty when the items are views into argv
+    if (ends.size() == items.size()) {
+        for (std::size_t i = first; i < items.size(); ++i) {
+            const std::size_t begin = i == 0 ? 0 : ends[i - 1];
+            items[i] = std::string_view(buffer.data() + begin, ends[i] - begin);
+        }
+    }
+    view = items;
+}
+
+CommandLineArgs::CommandLineArgs(std::pmr::memory_resource* resource, StringStorage storage) :
+    resource(resource),
+    paramTable(std::allocate_shared<ParamTable>(std::pmr::polymorphic_allocator<ParamTable>(resource), resource)),
+    valueStore(std::make_unique<ValueStore>(*paramTable, storage, resource)),
+    bindings(resource),
+    subcommands(resource),
+    positionals{nullptr, false},
+    validators(resource),
+    validatorCount(0),
+    validationThreads(1),
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+    instrumentation(std::make_unique<Instrumentation>()),
+#endif
+    description(resource),
+    programName("<program_name>", resource),
+    descriptionGenerated(false),
+    helpWidth(80),
+    stringStorage(storage)
+{ }
+
+CommandLineArgs::~CommandLineArgs() = default;
+
+std::shared_ptr<const ParsedArgs> CommandLineArgs::snapshot() const {
+    // Constructor of ParsedArgs is private, thus std::make_shared cannot be used
+    return std::shared_ptr<const ParsedArgs>(new ParsedArgs(paramTable, ParamValues(valueStore->values)));
+}
+
+std::vector<std::byte> CommandLineArgs::serialize() const {
+    return serialize(*paramTable, valueStore->values);
+}
+
+std::vector<CommandLineArgs::ParamId> CommandLineArgs::sortedByName(const ParamTable& table) {
+    std::vector<ParamId> ids(table.names.size());
+    for (ParamId id = 0; id < ids.size(); ++id) {
+        ids[id] = id;
+    }
+    std::sort(ids.begin(), ids.end(), [&table](const ParamId a, const ParamId b) {
+        return table.names[a] < table.names[b];
+    });
+    return ids;
+}
+
+std::vector<std::byte> CommandLineArgs::serialize(const ParamTable& table, const ParamValues& values) {
+    using detail::BlobHeader;
+    using detail::BlobParam;
+    const uint32_t count = uint32_t(table.names.size());
+    BlobWriter writer;
+    // The header is written last, when all offsets are known
+    writer.allocate(sizeof(BlobHeader), alignof(BlobHeader));
+    const uint64_t paramsOffset = writer.allocate(std::size_t(count) * sizeof(BlobParam), alignof(BlobParam));
+
+    const std::vector<ParamId> sortedIds = sortedByName(table);
+    const uint64_t sortedIdsOffset = writer.append(sortedIds.data(), sortedIds.size() * sizeof(uint32_t), alignof(uint32_t));
+
+    for (ParamId id = 0; id < count; ++id) {
+        BlobParam param{};
+        param.name = writer.appendText(table.names[id]);
+        param.column = table.columns[id];
+        param.type = uint8_t(table.types[id]);
+        param.present = values.present.test(id);
+        param.required = table.required.test(id);
+        param.source = uint8_t(values.sources[id]);
+        if (param.present) {
+            const uint32_t column = table.columns[id];
+            // Scalars take 8 bytes, so that each one is aligned for any scalar type
+            const auto appendScalar = [&writer](const auto value) {
+                const uint64_t offset = writer.allocate(8, 8);
+                writer.write(offset, value);
+                return offset;
+            };
+            switch (table.types[id]) {
+                case Type::Int: param.value = appendScalar(values.ints[column]); break;
+                case Type::Int64: param.value = appendScalar(values.int64s[column]); break;
+                case Type::UInt64:
+                case Type::Size: param.value = appendScalar(values.uint64s[column]); break;
+                case Type::Double: param.value = appendScalar(values.doubles[column]); break;
+                case Type::String: {
+                    const std::string_view value = column < values.strings.size() ?
+                        std::string_view(values.strings[column]) :
+                        values.stringViews[column];
+                    const detail::BlobString text = writer.appendText(value);
+                    param.value = text.offset;
+                    param.size = text.size;
+                } break;
+                case Type::IntList: {
+                    const std::span<const int> items = values.intLists[column].view;
+                    param.value = writer.append(items.data(), items.size_bytes(), alignof(int));
+                    param.size = items.size();
+                } break;
+                case Type::StringList: {
+                    const std::span<const std::string_view> items = values.stringLists[column].view;
+                    param.value = writer.appendTexts(items);
+                    param.size = items.size();
+                } break;
+                case Type::Flag:
+                case Type::Custom: break;
+            }
+        }
+        writer.write(paramsOffset + id * sizeof(BlobParam), param);
+    }
+    const std::span<const std::string_view> positionals = values.positionals.view;
+    const uint64_t positionalsOffset = writer.appendTexts(positionals);
+
+    BlobHeader header{};
+    std::copy_n(BlobHeader::expectedMagic, sizeof(header.magic), header.magic);
+    header.version = BlobHeader::currentVersion;
+    header.byteOrder = BlobHeader::byteOrderMark;
+    header.size = writer.data.size();
+    header.paramCount = count;
+    header.stringCount = table.stringCount;
+    header.intListCount = table.intListCount;
+    header.stringListCount = table.stringListCount;
+    header.params = paramsOffset;
+    header.sortedIds = sortedIdsOffset;
+    header.positionals = positionalsOffset;
+    header.positionalCount = positionals.size();
+    writer.write(0, header);
+    return std::move(writer.data);
+}
+
+SerializedArgs::ErrorCode SerializedArgs::open(const std::span<const std::byte> blob) {
+    using detail::BlobHeader;
+    using detail::BlobParam;
+    using detail::BlobString;
+    *this = SerializedArgs();
+    const uint64_t size = blob.size();
+    if (reinterpret_cast<std::uintptr_t>(blob.data()) % 8 != 0 || !inBlob(size, 0, 1, sizeof(BlobHeader), 1)) {
+        return ErrorCode::InvalidSerializedData;
+    }
+    BlobHeader header;
+    std::memcpy(&header, blob.data(), sizeof(header));
+    if (
+        !std::equal(header.magic, header.magic + sizeof(header.magic), BlobHeader::expectedMagic) ||
+        header.version != BlobHeader::currentVersion ||
+        header.byteOrder != BlobHeader::byteOrderMark ||
+        header.size != size ||
+        !inBlob(size, header.params, header.paramCount, sizeof(BlobParam), alignof(BlobParam)) ||
+        !inBlob(size, header.sortedIds, header.paramCount, sizeof(uint32_t), alignof(uint32_t)) ||
+        !inBlob(size, header.positionals, header.positionalCount, sizeof(BlobString), alignof(BlobString))
+    ) {
+        return ErrorCode::InvalidSerializedData;
+    }
+    const auto validText = [size](const BlobString& text) {
+        return inBlob(size, text.offset, text.size, 1, 1);
+    };
+    const auto* blobParams = reinterpret_cast<const BlobParam*>(blob.data() + header.params);
+    const auto* blobPositionals = reinterpret_cast<const BlobString*>(blob.data() + header.positionals);
+    const auto* blobSortedIds = reinterpret_cast<const uint32_t*>(blob.data() + header.sortedIds);
+
+    // Check everything first, so that the views below can be created without checks
+    uint64_t listItemCount = header.positionalCount;
+    for (uint64_t i = 0; i < header.positionalCount; ++i) {
+        if (!validText(blobPositionals[i])) {
+            return ErrorCode::InvalidSerializedData;
+        }
+    }
+    for (uint32_t id = 0; id < header.paramCount; ++id) {
+        const BlobParam& param = blobParams[id];
+        if (blobSortedIds[id] >= header.paramCount || param.type > uint8_t(Type::Custom) || !validText(param.name)) {
+            return ErrorCode::InvalidSerializedData;
+        }
+        const Type type = Type(param.type);
+        const bool validColumn =
+            (type != Type::String || param.column < header.stringCount) &&
+            (type != Type::IntList || param.column < header.intListCount) &&
+            (type != Type::StringList || param.column < header.stringListCount);
+        if (!validColumn) {
+            return ErrorCode::InvalidSerializedData;
+        }
+        if (!param.present) {
+            continue;
+        }
+        bool validValue = true;
+        switch (type) {
+            case Type::Int:
+            case Type::Int64:
+            case Type::UInt64:
+            case Type::Size:
+            case Type::Double: validValue = inBlob(size, param.value, 1, 8, 8); break;
+            case Type::String: validValue = validText(BlobString{param.value, param.size}); break;
+            case Type::IntList: validValue = inBlob(size, param.value, param.size, sizeof(int), alignof(int)); break;
+            case Type::StringList: {
+                validValue = inBlob(size, param.value, param.size, sizeof(BlobString), alignof(BlobString));
+                const auto* items = reinterpret_cast<const BlobString*>(blob.data() + param.value);
+                for (uint64_t i = 0; validValue && i < param.size; ++i) {
+                    validValue = validText(items[i]);
+                }
+                listItemCount += param.size;
+            } break;
+            case Type::Flag:
+            case Type::Custom: break;
+        }
+        if (!validValue) {
+            return ErrorCode::InvalidSerializedData;
+        }
+    }
+    // getParamId is a binary search over sortedIds, a table out of order would find wrong parameters without
+    // an error. Strictly increasing names also mean that no id is listed twice.
+    const auto nameOf = [&](const uint32_t id) {
+        const BlobString& name = blobParams[id].name;
+        return std::string_view(reinterpret_cast<const char*>(blob.data() + name.offset), name.size);
+    };
+    for (uint32_t i = 1; i < header.paramCount; ++i) {
+        if (nameOf(blobSortedIds[i - 1]) >= nameOf(blobSortedIds[i])) {
+            return ErrorCode::InvalidSerializedData;
+        }
+    }
+
+    strings.resize(header.stringCount);
+    intLists.resize(header.intListCount);
+    stringLists.resize(header.stringListCount);
+    // Reserved up front, the spans point into it while it is filled
+    listItems.reserve(listItemCount);
+    data = blob.data();
+    params = blobParams;
+    sortedIds = blobSortedIds;
+    paramCount = header.paramCount;
+    for (uint32_t id = 0; id < paramCount; ++id) {
+        const BlobParam& param = params[id];
+        if (!param.present) {
+            continue;
+        }
+        switch (Type(param.type)) {
+            case Type::String: strings[param.column] = text(BlobString{param.value, param.size}); break;
+            case Type::IntList: {
+                intLists[param.column] = std::span<const int>(reinterpret_cast<const int*>(data + param.value), param.size);
+            } break;
+            case Type::StringList: {
+                const std::size_t first = listItems.size();
+                const auto* items = reinterpret_cast<const BlobString*>(data + param.value);
+                for (uint64_t i = 0; i < param.size; ++i) {
+                    listItems.push_back(text(items[i]));
+                }
+                stringLists[param.column] = std::span<const std::string_view>(listItems.data() + first, param.size);
+            } break;
+            default: break;
+        }
+    }
+    const std::size_t first = listItems.size();
+    for (uint64_t i = 0; i < header.positionalCount; ++i) {
+        listItems.push_back(text(blobPositionals[i]));
+    }
+    positionals = std::span<const std::string_view>(listItems.data() + first, header.positionalCount);
+    return ErrorCode::Success;
+}
+
+SerializedArgs::ParamId SerializedArgs::getParamId(const std::string_view param) const {
+    const uint32_t* const end = sortedIds + paramCount;
+    const uint32_t* const it = std::lower_bound(sortedIds, end, param, [this](uint32_t id, std::string_view name) {
+        return text(params[id].name) < name;
+    });
+    return it != end && text(params[*it].name) == param ? *it : CommandLineArgs::invalidParamId;
+}
+
+CommandLineArgs::ParamTable& CommandLineArgs::mutableTable() {
+    if (paramTable.use_count() > 1) {
+        paramTable = std::allocate_shared<ParamTable>(
+            std::pmr::polymorphic_allocator<ParamTable>(resource),
+            *paramTable,
+            resource
+        );
+    }
+    return *paramTable;
+}
+
+void CommandLineArgs::freeValues() {
+    // All values are allocated from the arena. They are destroyed and then the arena is reset
+    // which makes its memory available for the next parse.
+    ValueStore& store = *valueStore;
+    std::destroy_at(&store.values);
+    store.arena.reset();
+    std::construct_at(&store.values, *paramTable, stringStorage, &store.arena);
+    for (Subcommand& subcommand : subcommands.list) {
+        if (subcommand.args) {
+            subcommand.args->freeValues();
+        }
+    }
+    subcommands.active = -1;
+    validationErrors.clear();
+}
+
+void CommandLineArgs::freeMem() {
+    paramTable = std::allocate_shared<ParamTable>(std::pmr::polymorphic_allocator<ParamTable>(resource), resource);
+    valueStore = std::make_unique<ValueStore>(*paramTable, stringStorage, resource);
+    bindings.clear();
+    validators.clear();
+    validatorCount = 0;
+    validationErrors.clear();
+    subcommands.list.clear();
+    subcommands.ids.clear();
+    subcommands.active = -1;
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+    instrumentation->accessCounts.clear();
+#endif
+    descriptionGenerated = false;
+}
+
+CommandLineArgs::ParseStats CommandLineArgs::getStats() const {
+    ParseStats stats;
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+    const Instrumentation& counters = *instrumentation;
+    stats.parseCount = counters.parseCount.load(std::memory_order_relaxed);
+    stats.argumentCount = counters.argumentCount.load(std::memory_order_relaxed);
+    stats.tokenizeTime = std::chrono::nanoseconds(counters.tokenizeTime.load(std::memory_order_relaxed));
+    stats.lookupTime = std::chrono::nanoseconds(counters.lookupTime.load(std::memory_order_relaxed));
+    stats.convertTime = std::chrono::nanoseconds(counters.convertTime.load(std::memory_order_relaxed));
+    stats.requiredCheckTime = std::chrono::nanoseconds(counters.requiredCheckTime.load(std::memory_order_relaxed));
+    stats.allocationCount = counters.allocationCount.load(std::memory_order_relaxed);
+    stats.allocatedBytes = counters.allocatedBytes.load(std::memory_order_relaxed);
+    stats.lookupMisses = counters.lookupMisses.load(std::memory_order_relaxed);
+#endif
+    return stats;
+}
+
+uint64_t CommandLineArgs::getAccessCount([[maybe_unused]] ParamId id) const {
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+    if (id < instrumentation->accessCounts.size()) {
+        return instrumentation->accessCounts[id].load(std::memory_order_relaxed);
+    }
+#endif
+    return 0;
+}
+
+void CommandLineArgs::resetStats() {
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+    Instrumentation& counters = *instrumentation;
+    counters.parseCount = 0;
+    counters.argumentCount = 0;
+    counters.tokenizeTime = 0;
+    counters.lookupTime = 0;
+    counters.convertTime = 0;
+    counters.requiredCheckTime = 0;
+    counters.allocationCount = 0;
+    counters.allocatedBytes = 0;
+    counters.lookupMisses = 0;
+    for (std::atomic<uint64_t>& count : counters.accessCounts) {
+        count = 0;
+    }
+#endif
+}
+
+void CommandLineArgs::setObserver([[maybe_unused]] ParseObserver* observer) {
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+    instrumentation->observer.store(observer, std::memory_order_release);
+#endif
+}
+
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+void CommandLineArgs::Instrumentation::add(const ParseStats& stats) {
+    parseCount.fetch_add(1, std::memory_order_relaxed);
+    argumentCount.fetch_add(stats.argumentCount, std::memory_order_relaxed);
+    tokenizeTime.fetch_add(stats.tokenizeTime.count(), std::memory_order_relaxed);
+    lookupTime.fetch_add(stats.lookupTime.count(), std::memory_order_relaxed);
+    convertTime.fetch_add(stats.convertTime.count(), std::memory_order_relaxed);
+    requiredCheckTime.fetch_add(stats.requiredCheckTime.count(), std::memory_order_relaxed);
+    allocationCount.fetch_add(stats.allocationCount, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(stats.allocatedBytes, std::memory_order_relaxed);
+}
+
+void CommandLineArgs::recordAccess(ParamId id) const {
+    if (id >= instrumentation->accessCounts.size()) {
+        return;
+    }
+    instrumentation->accessCounts[id].fetch_add(1, std::memory_order_relaxed);
+    if (ParseObserver* observer = instrumentation->observer.load(std::memory_order_acquire)) {
+        observer->onAccess(id);
+    }
+}
+
+void CommandLineArgs::recordParse(const ParseStats& stats) const {
+    ParseStats parseStats = stats;
+    parseStats.parseCount = 1;
+    instrumentation->add(parseStats);
+    if (ParseObserver* observer = instrumentation->observer.load(std::memory_order_acquire)) {
+        observer->onParse(parseStats);
+    }
+}
+#endif
+
+std::string_view CommandLineArgs::getHelp() const {
+    if (descriptionGenerated) {
+        return description;
+    }
+    description.clear();
+    const ParamTable& table = *paramTable;
+    description.append("Usage: ").append(programName);
+    if (!table.names.empty()) {
+        description.append(" [OPTIONS]");
+    }
+    if (!subcommands.list.empty()) {
+        description.append(" COMMAND [COMMAND OPTIONS]");
+    }
+    description.push_back('\n');
+    // Descriptions start in one column after the longest name, but not further than half of the width.
+    // Names which do not fit put their description on the next line.
+    constexpr std::size_t gap = 2;
+    constexpr std::size_t minTextWidth = 20;
+    const std::size_t maxColumn = helpWidth == 0 ? std::numeric_limits<std::size_t>::max() : helpWidth / 2;
+    const auto appendEntry = [&](const std::size_t entryStart, const std::size_t column, const std::string_view text, const bool required) {
+        const std::size_t used = description.size() - entryStart;
+        if (text.empty() && !required) {
+            description.push_back('\n');
+            return;
+        }
+        if (used + gap > column) {
+            description.push_back('\n');
+            description.append(column, ' ');
+        } else {
+            description.append(column - used, ' ');
+        }
+        const std::size_t textWidth = helpWidth == 0 ? 0 : std::max(helpWidth > column ? helpWidth - column : 0, minTextWidth);
+        const std::size_t lineLength = appendWrapped(description, text, column, textWidth);
+        if (required) {
+            appendWrapped(description, "[REQUIRED]", column, textWidth, lineLength);
+        }
+        description.push_back('\n');
+    };
+
+    if (!table.names.empty()) {
+        const std::vector<ParamId> ids = sortedByName(table);
+        // "  -j, --jobs <int>"
+        const auto optionWidth = [&table](const ParamId id) {
+            const std::string_view placeholder = valuePlaceholder(table.types[id]);
+            return 8 + table.names[id].size() + (placeholder.empty() ? 0 : placeholder.size() + 1);
+        };
+        std::size_t column = 0;
+        for (const ParamId id : ids) {
+            column = std::max(column, optionWidth(id));
+        }
+        column = std::min(column, maxColumn) + gap;
+        description.append("\nOptions:\n");
+        for (const ParamId id : ids) {
+            const std::size_t entryStart = description.size();
+            if (table.shortNames[id] != '\0') {
+                description.append("  -").push_back(table.shortNames[id]);
+                description.append(", --");
+            } else {
+                description.append("      --");
+            }
+            description.append(table.names[id]);
+            const std::string_view placeholder = valuePlaceholder(table.types[id]);
+            if (!placeholder.empty()) {
+                description.push_back(' ');
+                description.append(placeholder);
+            }
+            appendEntry(entryStart, column, table.descriptions[id], table.required.test(id));
+        }
+    }
+    if (!subcommands.list.empty()) {
+        std::vector<uint32_t> indices(subcommands.list.size());
+        std::size_t column = 0;
+        for (uint32_t i = 0; i < indices.size(); ++i) {
+            indices[i] = i;
+            column = std::max(column, 2 + subcommands.list[i].name.size());
+        }
+        std::sort(indices.begin(), indices.end(), [this](const uint32_t a, const uint32_t b) {
+            return subcommands.list[a].name < subcommands.list[b].name;
+        });
+        column = std::min(column, maxColumn) + gap;
+        description.append("\nCommands:\n");
+        for (const uint32_t i : indices) {
+            const std::size_t entryStart = description.size();
+            description.append("  ").append(subcommands.list[i].name);
+            appendEntry(entryStart, column, subcommands.list[i].description, false);
+        }
+    }
+    descriptionGenerated = true;
+    return description;
+}
+
+std::string CommandLineArgs::getDescription() const {
+    return std::string(getHelp());
+}
+
+void CommandLineArgs::printHelp(std::FILE* file) const {
+    const std::string_view help = getHelp();
+    std::fwrite(help.data(), 1, help.size(), file);
+}
+
+void CommandLineArgs::printHelp(std::ostream& stream) const {
+    const std::string_view help = getHelp();
+    stream.write(help.data(), std::streamsize(help.size()));
+}
+
+void CommandLineArgs::setHelpWidth(const unsigned columns) {
+    if (helpWidth != columns) {
+        helpWidth = columns;
+        descriptionGenerated = false;
+    }
+}
+
+std::string CommandLineArgs::getCompletionScript(const Shell shell, std::string_view command) const {
+    if (command.empty()) {
+        command = programName;
+        const std::size_t separator = command.find_last_of("/\\");
+        if (separator != std::string_view::npos) {
+            command.remove_prefix(separator + 1);
+        }
+    }
+    std::string function = "_";
+    for (const char c : command) {
+        function.push_back(std::isalnum(static_cast<unsigned char>(c)) ? c : '_');
+    }
+    function.append("_complete");
+
+    const auto collectOptions = [](const ParamTable& table) {
+        std::vector<CompletionOption> options;
+        for (const ParamId id : sortedByName(table)) {
+            const Type type = table.types[id];
+            options.push_back(CompletionOption{
+                table.names[id],
+                table.descriptions[id],
+                table.shortNames[id],
+                type != Type::Flag,
+                type == Type::IntList || type == Type::StringList,
+                type == Type::String
+            });
+        }
+        return options;
+    };
+    const std::vector<CompletionOption> options = collectOptions(*paramTable);
+    // Parsers built only for the script, the options point into them
+    std::vector<std::unique_ptr<CommandLineArgs>> built;
+    std::vector<CompletionCommand> commands;
+    for (const Subcommand& subcommand : subcommands.list) {
+        const CommandLineArgs* args = subcommand.args.get();
+        if (!args && subcommand.factory) {
+            auto temporary = std::make_unique<CommandLineArgs>(resource, stringStorage);
+            if (subcommand.factory(*temporary) == ErrorCode::Success) {
+                args = temporary.get();
+                built.push_back(std::move(temporary));
+            }
+        }
+        commands.push_back(CompletionCommand{
+            subcommand.name,
+            subcommand.description,
+            args ? collectOptions(*args->paramTable) : std::vector<CompletionOption>{}
+        });
+    }
+    std::sort(commands.begin(), commands.end(), [](const CompletionCommand& a, const CompletionCommand& b) {
+        return a.name < b.name;
+    });
+    return shell == Shell::Bash ?
+        bashCompletion(command, function, options, commands) :
+        zshCompletion(command, function, options, commands);
+}
+
+std::vector<CommandLineArgs::ParamId> CommandLineArgs::changedParams(
+    const ParamTable& table,
+    const ParamValues& values,
+    const ParamTable& otherTable,
+    const ParamValues& otherValues
+) {
+    // Both snapshots come from the same parser. Ids and columns of the parameters they share are the same,
+    // parameters added later exist only in the newer one.
+    const ParamId common = ParamId(std::min(table.names.size(), otherTable.names.size()));
+    const auto sameValue = [&](ParamId id) {
+        const uint32_t column = table.columns[id];
+        switch (table.types[id]) {
+            case Type::Int: return values.ints[column] == otherValues.ints[column];
+            case Type::Int64: return values.int64s[column] == otherValues.int64s[column];
+            case Type::UInt64:
+            case Type::Size: return values.uint64s[column] == otherValues.uint64s[column];
+            case Type::Double: return values.doubles[column] == otherValues.doubles[column];
+            case Type::String: return column < values.strings.size() ?
+                values.strings[column] == otherValues.strings[column] :
+                values.stringViews[column] == otherValues.stringViews[column];
+            case Type::IntList: return std::ranges::equal(values.intLists[column].view, otherValues.intLists[column].view);
+            case Type::StringList: return std::ranges::equal(values.stringLists[column].view, otherValues.stringLists[column].view);
+            case Type::Custom: return values.customs[column].equals(otherValues.customs[column]);
+            case Type::Flag: return true;
+        }
+        return false;
+    };
+    std::vector<ParamId> changed;
+    for (ParamId id = 0; id < common; ++id) {
+        const bool isPresent = values.present.test(id);
+        if (isPresent != otherValues.present.test(id) || (isPresent && !sameValue(id))) {
+            changed.push_back(id);
+        }
+    }
+    const ParamId total = ParamId(std::max(table.names.size(), otherTable.names.size()));
+    for (ParamId id = common; id < total; ++id) {
+        changed.push_back(id);
+    }
+    return changed;
+}
+
+ReloadableArgs::ReloadableArgs(const CommandLineArgs& parser, std::shared_ptr<const ParsedArgs> initial) :
+    parser(parser),
+    current(new Slot{std::move(initial)}),
+    epoch(0),
+    readers{0, 0}
+{ }
+
+ReloadableArgs::~ReloadableArgs() {
+    delete current.load();
+}
+
+ReloadableArgs::Reader ReloadableArgs::read() const {
+    // The counter is incremented before the slot is loaded. A publish which replaces the slot after this
+    // point waits for the counter, see waitForReaders.
+    std::atomic<uint64_t>& counter = readers[epoch.load() & 1];
+    counter.fetch_add(1);
+    return Reader(&counter, current.load());
+}
+
+std::shared_ptr<const ParsedArgs> ReloadableArgs::load() const {
+    const Reader reader = read();
+    return reader.slot->args;
+}
+
+ReloadableArgs::ErrorCode ReloadableArgs::reload(
+    const int argc,
+    char** argv,
+    const CommandLineArgs::Sources& sources,
+    CommandLineArgs::ErrorCallbackT errorCallback,
+    std::vector<CommandLineArgs::ValidationError>* validationErrors
+) {
+    std::shared_ptr<const ParsedArgs> args;
+    const ErrorCode code = parser.parse(argc, argv, sources, args, errorCallback, validationErrors);
+    if (code == ErrorCode::Success) {
+        publish(std::move(args));
+    }
+    return code;
+}
+
+void ReloadableArgs::publish(std::shared_ptr<const ParsedArgs> args) {
+    std::lock_guard lock(publishMutex);
+    Slot* const old = current.exchange(new Slot{std::move(args)});
+    waitForReaders();
+    const Slot* const slot = current.load(std::memory_order_relaxed);
+    if (changeCallback && old->args && slot->args) {
+        const std::vector<ParamId> changed = slot->args->changedParams(*old->args);
+        if (!changed.empty()) {
+            changeCallback(*old->args, *slot->args, changed);
+        }
+    }
+    delete old;
+}
+
+void ReloadableArgs::setChangeCallback(ChangeCallbackT callback) {
+    std::lock_guard lock(publishMutex);
+    changeCallback = std::move(callback);
+}
+
+void ReloadableArgs::waitForReaders() {
+    // A reader which read the epoch before a flip can increment the counter of the previous epoch after
+    // the flip. Flipping twice and draining both counters covers readers which are one epoch behind.
+    for (int flip = 0; flip < 2; ++flip) {
+        const uint64_t previous = epoch.fetch_add(1);
+        const std::atomic<uint64_t>& counter = readers[previous & 1];
+        while (counter.load() != 0) {
+            std::this_thread::yield();
+        }
     }
-    return description;
 }
 
-} // namespace CMD
\ No newline at end of file
+} // namespace CMD
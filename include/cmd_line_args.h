@@ -1,57 +1,306 @@
 #pragma once
 #include <unordered_map>
+#include <vector>
+#include <array>
+#include <span>
 #include <string>
-#include <optional>
-#include <variant>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <atomic>
+#include <mutex>
+#include <concepts>
+#include <type_traits>
+#include <new>
+#include <iterator>
+#include <iosfwd>
+#include <cstdio>
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+	#include <deque>
+#endif
 
 /// @mainpage Command Line Arguments Parser
 ///
 /// Parses command line arguments passed to programs of the form:
 /// @code
-///		program --param=value
+///		program --param=value --param value -p value -pvalue -abc
 /// @endcode
 /// It supports parameters with types and does type checking for each parameter. For supported types
 /// see CMD::CommandLineArgs::Type.
 /// 
-/// Currently supports only long parameter names starting with two dashes -- followed by the name of the parameter.
-/// Non flag parameters must have a value. It is passed by an equals sign with now whitespace between the equals
-/// the name of the parameter and the value of the parameter.
+/// Parameters have a long name which is passed after two dashes, e.g. --jobs. A parameter can also have a
+/// one character short name, set with CMD::CommandLineArgs::setShortName, which is passed after one dash, e.g. -j.
+/// Flags do not take a value. Other parameters must have a value, which is passed in one of the forms:
+/// - --jobs=8, after an equals sign with no whitespace around it
+/// - --jobs 8 or -j 8, the next argument is the value when the argument names a parameter which is not a flag
+///   and has no value attached. The next argument is taken as it is, even if it starts with a dash.
+/// - -j8, attached to the short name
+///
+/// Short flags can be bundled after one dash, -abc is the same as -a -b -c. The last option of a bundle can take
+/// a value, attached or in the next argument: -vj8 or -vj 8. A parameter which needs a value, but is the last
+/// argument, is reported with CMD::CommandLineArgs::ErrorCode::MissingValue. An argument starting with one dash,
+/// which is not a known short name, is parsed as before, e.g. a negative number can be a positional argument.
 /// 
-/// Positional arguments are not supported at the moment, however some arguments can be marked as required. Check
+/// Positional arguments are accepted when a callback is set with CMD::CommandLineArgs::setPositionalCallback or they are
+/// collected with CMD::CommandLineArgs::setCollectPositionals. Some arguments can be marked as required. Check
 /// CMD::CommandLineArgs::addParam to see how to add required parameter.
 /// 
 /// Usage:
 ///	- Create CMD::CommandLineArgs class
-/// - Add parameters via CMD::CommandLineArgs::addParam
+/// - Add parameters via CMD::CommandLineArgs::addParam and optionally short names via CMD::CommandLineArgs::setShortName
 /// - Parse the parameters passed to main via CMD::CommandLineArgs::parse
 /// - Request parameters via CMD::CommandLineArgs::getValue
 /// 
 /// @code
-/// 	int main(int argc, char** argv) {
+///		int main(int argc, char** argv) {
 ///			using namespace CMD;
 ///			CommandLineArgs parser;
-///			parser.addParam(CommandLineArgs::Type::Int, "intParam", false);
-/// 		parser.addParam(CommandLineArgs::Type::Flag, "flag", false);
-/// 		parser.addParam(CommandLineArgs::Type::String, "str", true);
-///			if(parser.parse(argc, argv) != CommandLineArgs::ErrorCode::Success) {
-/// 			return 1;
+///			CommandLineArgs::ParamId jobsId, verboseId;
+///			parser.addParam(CommandLineArgs::Type::Int, "jobs", "Number of jobs", false, &jobsId);
+///			parser.addParam(CommandLineArgs::Type::Flag, "verbose", "Verbose output", false, &verboseId);
+///			parser.addParam(CommandLineArgs::Type::String, "out", "Output file", true);
+///			parser.setShortName(jobsId, 'j');
+///			parser.setShortName(verboseId, 'v');
+///			// Accepts e.g. program --out=a.txt --jobs=8, program --out a.txt -j 8 or program -vj8 --out a.txt
+///			if (parser.parse(argc, argv) != CommandLineArgs::ErrorCode::Success) {
+///				parser.printHelp(stderr);
+///				return 1;
 ///			}
-/// 
-///			const int* intParam = parser.getValue<CommandLineArgs::Type::Int>("intParam"); // If --intParam=value was not passed, getValue returns nullptr
-///			if(intParam) {
-///				std::cout<<*intParam;
-/// 		}
-/// 
-///			const bool* flag = parser.getValue<CommandLineArgs::Type::Int>("flag") // Flag always return non null. If passed returns ptr to true, otherwise to false
-///			std::cout<<*flag;
-/// 
-///			const std::string* str = parser.getValue<CommandLineArgs::Type::String>("str") // It was added with required=true it will always have non null ptr
-///			std::cout<<*str;
-/// 	}
+///
+///			const int* jobs = parser.getValue<CommandLineArgs::Type::Int>(jobsId); // If --jobs was not passed, getValue returns nullptr
+///			if (jobs) {
+///				std::cout << *jobs;
+///			}
+///
+///			const bool* verbose = parser.getValue<CommandLineArgs::Type::Flag>(verboseId); // Flag always returns non null. If passed it points to true, otherwise to false
+///			std::cout << *verbose;
+///
+///			const std::string* out = parser.getValue<CommandLineArgs::Type::String>("out"); // It was added with required=true, it is never null after a successful parse
+///			std::cout << *out;
+///		}
 /// @endcode
 
 namespace CMD {
 
+class ParsedArgs;
+
+/// @brief Converts the text of a parameter to a user type
+///
+/// Specialize it for each type used with CMD::CommandLineArgs::addParam<T>. parse converts the value once
+/// and stores it as T, getValue<T> returns a pointer to the stored value. parse returns false if the text is
+/// not a valid value, it is reported as ErrorCode::WrongValueType.
+/// @code
+///		template<>
+///		struct CMD::ValueParser<std::chrono::milliseconds> {
+///			static bool parse(std::string_view text, std::chrono::milliseconds& out);
+///		};
+/// @endcode
+template<typename T>
+struct ValueParser;
+
+/// @brief Type which can be the type of a parameter through CMD::ValueParser
+template<typename T>
+concept ParsableValue = std::default_initializable<T> && std::copy_constructible<T> &&
+	requires(std::string_view text, T& out) {
+		{ ValueParser<T>::parse(text, out) } -> std::convertible_to<bool>;
+	};
+
+namespace detail {
+/// Storage for the value of flags. Flags do not have value column, the pointer returned by getValue
+/// points here depending on whether the flag was passed.
+inline constexpr bool flagValues[2] = {false, true};
+/// Response file mapped in memory
+class MappedFile;
+
+/// @brief Operations on values of one user type. Parameters with user type store a pointer to it, which
+/// also identifies the type when the value is requested.
+struct CustomType {
+	std::size_t size;
+	std::size_t alignment;
+	void (*construct)(void* object);
+	void (*copy)(void* object, const void* other);
+	void (*destroy)(void* object);
+	/// Copy assign the value to a variable bound to the parameter
+	void (*assign)(void* destination, const void* object);
+	bool (*parse)(std::string_view text, void* object);
+	/// Null if T has no operator==, values are then always reported as changed
+	bool (*equal)(const void* object, const void* other);
+};
+
+template<ParsableValue T>
+inline constexpr CustomType customTypeOf = {
+	sizeof(T),
+	alignof(T),
+	[](void* object) { ::new (object) T(); },
+	[](void* object, const void* other) { ::new (object) T(*static_cast<const T*>(other)); },
+	[](void* object) { static_cast<T*>(object)->~T(); },
+	[](void* destination, const void* object) { *static_cast<T*>(destination) = *static_cast<const T*>(object); },
+	[](std::string_view text, void* object) { return bool(ValueParser<T>::parse(text, *static_cast<T*>(object))); },
+	[]() -> bool (*)(const void*, const void*) {
+		if constexpr (std::equality_comparable<T>) {
+			return [](const void* object, const void* other) {
+				return bool(*static_cast<const T*>(object) == *static_cast<const T*>(other));
+			};
+		} else {
+			return nullptr;
+		}
+	}()
+};
+
+/// @brief Value of one parameter with user type. The object is allocated from the allocator of the column
+/// which holds it, same as the items of the lists.
+class CustomValue {
+public:
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+
+	explicit CustomValue(const CustomType* type, const allocator_type& allocator = {}) :
+		type(type),
+		allocator(allocator),
+		object(this->allocator.allocate_bytes(type->size, type->alignment))
+	{
+		type->construct(object);
+	}
+
+	CustomValue(const CustomValue& other, const allocator_type& allocator = {}) :
+		type(other.type),
+		allocator(allocator),
+		object(this->allocator.allocate_bytes(type->size, type->alignment))
+	{
+		type->copy(object, other.object);
+	}
+
+	CustomValue(CustomValue&& other, const allocator_type& allocator) :
+		type(other.type),
+		allocator(allocator)
+	{
+		if (allocator == other.allocator) {
+			object = std::exchange(other.object, nullptr);
+		} else {
+			object = this->allocator.allocate_bytes(type->size, type->alignment);
+			type->copy(object, other.object);
+		}
+	}
+
+	CustomValue(CustomValue&& other) noexcept :
+		type(other.type),
+		allocator(other.allocator),
+		object(std::exchange(other.object, nullptr))
+	{ }
+
+	CustomValue& operator=(const CustomValue&) = delete;
+	CustomValue& operator=(CustomValue&&) = delete;
+
+	~CustomValue() {
+		if (object) {
+			type->destroy(object);
+			allocator.deallocate_bytes(object, type->size, type->alignment);
+		}
+	}
+
+	const CustomType* getType() const {
+		return type;
+	}
+
+	const void* get() const {
+		return object;
+	}
+
+	/// @brief Convert the text into the stored value
+	bool parse(std::string_view text) {
+		return type->parse(text, object);
+	}
+
+	/// @brief Copy the value to a variable of the same type
+	void assignTo(void* destination) const {
+		type->assign(destination, object);
+	}
+
+	bool equals(const CustomValue& other) const {
+		return type == other.type && type->equal && type->equal(object, other.object);
+	}
+private:
+	const CustomType* type;
+	allocator_type allocator;
+	void* object;
+};
+}
+
+/// @brief Bump allocator which can be reset in O(1)
+///
+/// Memory is taken from the upstream resource in blocks and handed out by bumping a pointer.
+/// Deallocation does nothing. CMD::ArenaResource::reset makes all memory available again, but keeps
+/// the blocks, thus after the arena has grown to its working size, allocations do not reach the
+/// upstream resource anymore.
+class ArenaResource : public std::pmr::memory_resource {
+public:
+	/// @param[in] upstream Resource used to allocate the blocks
+	/// @param[in] initialBlockSize Size in bytes of the first block, following blocks double in size
+	explicit ArenaResource(
+		std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+		std::size_t initialBlockSize = 4096
+	) :
+		upstream(upstream),
+		nextBlockSize(initialBlockSize)
+	{ }
+	~ArenaResource();
+
+	ArenaResource(const ArenaResource&) = delete;
+	ArenaResource& operator=(const ArenaResource&) = delete;
+
+	/// @brief Make all memory available for allocation. Everything allocated before is invalidated.
+	void reset();
+	/// @brief Return all blocks to the upstream resource
+	void release();
+	/// @brief Total size of the blocks taken from the upstream resource
+	std::size_t capacity() const {
+		return totalCapacity;
+	}
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+	/// @brief Number of allocations made from the arena since it was created
+	uint64_t allocationCount() const {
+		return allocations;
+	}
+	/// @brief Number of bytes allocated from the arena since it was created
+	uint64_t allocatedBytes() const {
+		return allocatedSize;
+	}
+#endif
+private:
+	struct Block {
+		Block* next;
+		std::size_t size;
+	};
+
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void do_deallocate(void*, std::size_t, std::size_t) override { }
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+
+	std::pmr::memory_resource* upstream;
+	/// All blocks taken from upstream, in order of allocation
+	Block* head = nullptr;
+	/// Block which is currently used for allocation, following blocks are free
+	Block* current = nullptr;
+	/// Next free byte in the current block
+	char* cursor = nullptr;
+	/// End of the current block
+	char* end = nullptr;
+	std::size_t nextBlockSize;
+	std::size_t totalCapacity = 0;
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+	uint64_t allocations = 0;
+	uint64_t allocatedSize = 0;
+#endif
+};
+
 /// @brief Class to parse and hold command line arguments
 ///
 /// How to use:
@@ -62,33 +311,38 @@ namespace CMD {
 /// 
 /// Example usage:
 /// @code
-/// 	int main(int argc, char** argv) {
+///		int main(int argc, char** argv) {
 ///			using namespace CMD;
 ///			CommandLineArgs parser;
-///			parser.addParam(CommandLineArgs::Type::Int, "intParam", false);
-/// 		parser.addParam(CommandLineArgs::Type::Flag, "flag", false);
-/// 		parser.addParam(CommandLineArgs::Type::String, "str", true);
-///			if(parser.parse(argc, argv) != CommandLineArgs::ErrorCode::Success) {
-/// 			return 1;
+///			CommandLineArgs::ParamId jobsId, verboseId, extractId;
+///			parser.addParam(CommandLineArgs::Type::Int, "jobs", "Number of jobs", false, &jobsId);
+///			parser.addParam(CommandLineArgs::Type::Flag, "verbose", "Verbose output", false, &verboseId);
+///			parser.addParam(CommandLineArgs::Type::Flag, "extract", "Extract the archive", false, &extractId);
+///			parser.addParam(CommandLineArgs::Type::String, "str", "A string", true);
+///			parser.setShortName(jobsId, 'j');
+///			parser.setShortName(verboseId, 'v');
+///			parser.setShortName(extractId, 'x');
+///			// e.g. program --str=text --jobs=8, program --str text -j 8 or program -vvx -j8 --str text
+///			if (parser.parse(argc, argv) != CommandLineArgs::ErrorCode::Success) {
+///				return 1;
 ///			}
-/// 
-///			const int* intParam = parser.getValue<CommandLineArgs::Type::Int>("intParam"); // If --intParam=value was not passed, getValue returns nullptr
-///			if(intParam) {
-///				std::cout<<*intParam;
-/// 		}
-/// 
-///			const bool* flag = parser.getValue<CommandLineArgs::Type::Int>("flag") // Flag always return non null. If passed returns ptr to true, otherwise to false
-///			std::cout<<*flag;
-/// 
-///			const std::string* str = parser.getValue<CommandLineArgs::Type::String>("str") // It was added with required=true it will always have non null ptr
-///			std::cout<<*str;
-/// 	}
+///
+///			const int* jobs = parser.getValue<CommandLineArgs::Type::Int>("jobs"); // If --jobs was not passed, getValue returns nullptr
+///			if (jobs) {
+///				std::cout << *jobs;
+///			}
+///
+///			const bool* verbose = parser.getValue<CommandLineArgs::Type::Flag>("verbose"); // Flag always returns non null. If passed it points to true, otherwise to false
+///			std::cout << *verbose;
+///
+///			const std::string* str = parser.getValue<CommandLineArgs::Type::String>("str"); // It was added with required=true, it is never null after a successful parse
+///			std::cout << *str;
+///		}
 /// @endcode
 class CommandLineArgs {
 public:
 	CommandLineArgs() :
-		descriptionGenerated(false),
-		programName("<program_name>")
+		CommandLineArgs(StringStorage::Copy)
 	{ }
 	~CommandLineArgs();
 
@@ -105,19 +359,70 @@ public:
 		WrongValueType, ///< The type of the value of a parameter is not the same as in the definition
 		UnknownParameter, ///< Parsed parameter name which was not defined
 		FlagHasValue, ///< Parameter with type bool was passed a value with -flag=value.
-		MissingValue, ///< Parameter which requires a value was not passed a value with -param=value
+		MissingValue, ///< Parameter which requires a value was not passed a value with --param=value, --param value or -p value
 		ParameterExists, ///< Trying to define a parameter more than once
 		WrongParamFormat, ///< Parameter does not start with --
-		UnknownParsingError ///< Unknown error during parsing
+		UnknownParsingError, ///< Unknown error during parsing
+		ResponseFileError, ///< Response file cannot be read, has a quote which is not closed or is nested too deep
+		UnknownSubcommand, ///< Subcommands are added, but none or unknown subcommand was passed
+		ValidationFailed, ///< A validator rejected one or more values, see CMD::CommandLineArgs::setValidator
+		ConfigFileError, ///< Config file cannot be read or has a line which is not key=value, key or [section]
+		InvalidSerializedData, ///< Data passed to CMD::SerializedArgs::open was not written by serialize of this version
+		UnclosedQuote ///< Command line passed to parse as one string has a quote which is not closed
 	};
 
 	/// @brief Supported parameter types
+	///
+	/// Integers can be written in decimal, in hex with 0x prefix or in octal with 0 prefix. Values which do
+	/// not fit in the type of the parameter are reported as ErrorCode::WrongValueType.
 	enum class Type {
-		Int,
-		String,
-		Flag
+		Int, ///< int
+		String, ///< std::string or std::string_view, see CMD::CommandLineArgs::StringStorage
+		Flag, ///< bool, flags do not take value
+		Int64, ///< int64_t
+		UInt64, ///< uint64_t, negative values are not allowed
+		Double, ///< double
+		/// uint64_t, number of bytes. Can have K, M, G, T or P suffix (case insensitive)
+		/// meaning multiplication by 2^10, 2^20, 2^30, 2^40 or 2^50, e.g. 64K or 2G.
+		Size,
+		/// std::span<const int>, comma separated list of integers e.g. --shards=0,1,2. If the parameter is
+		/// passed more than once the values are appended to the list.
+		IntList,
+		/// std::span<const std::string_view>, comma separated list of strings e.g. --inputs=a.txt,b.txt.
+		/// If the parameter is passed more than once the values are appended to the list. With
+		/// StringStorage::View the strings point into argv, otherwise into a buffer owned by the parser.
+		StringList,
+		/// User type T, added with addParam<T> and converted by CMD::ValueParser<T>. Requested with getValue<T>.
+		Custom
+	};
+
+	/// @brief How values of Type::String parameters are stored
+	enum class StringStorage {
+		/// Each value is copied in an std::string. Values are requested with getValue<Type::String>.
+		Copy,
+		/// Values are std::string_view into the argv passed to parse, nothing is copied. The argv must
+		/// outlive the parsed values. Values are requested with getValue<Type::String, std::string_view>.
+		View
 	};
 
+	/// @brief Shells for which getCompletionScript generates a script
+	enum class Shell {
+		Bash,
+		Zsh
+	};
+
+	/// @param[in] storage How to store string values, see CMD::CommandLineArgs::StringStorage
+	explicit CommandLineArgs(StringStorage storage) :
+		CommandLineArgs(std::pmr::get_default_resource(), storage)
+	{ }
+
+	/// @param[in] resource All parameter info is allocated from this resource. Parsed values are allocated
+	/// from an CMD::ArenaResource which takes its memory from this resource. The resource must outlive the
+	/// parser and all snapshots created by it. Note that string values copied with StringStorage::Copy are
+	/// std::string and allocate from the global heap if they do not fit in the small string buffer.
+	/// @param[in] storage How to store string values, see CMD::CommandLineArgs::StringStorage
+	explicit CommandLineArgs(std::pmr::memory_resource* resource, StringStorage storage = StringStorage::Copy);
+
 private:
 	template<Type T>
 	struct TypeMatch {
@@ -137,6 +442,36 @@ private:
 	struct TypeMatch<Type::Flag> {
 		using type = bool;
 	};
+
+	template<>
+	struct TypeMatch<Type::Int64> {
+		using type = int64_t;
+	};
+
+	template<>
+	struct TypeMatch<Type::UInt64> {
+		using type = uint64_t;
+	};
+
+	template<>
+	struct TypeMatch<Type::Double> {
+		using type = double;
+	};
+
+	template<>
+	struct TypeMatch<Type::Size> {
+		using type = uint64_t;
+	};
+
+	template<>
+	struct TypeMatch<Type::IntList> {
+		using type = std::span<const int>;
+	};
+
+	template<>
+	struct TypeMatch<Type::StringList> {
+		using type = std::span<const std::string_view>;
+	};
 public:
 
 	/// @brief Type of the callback function which can be passed to parse
@@ -146,15 +481,164 @@ public:
 	/// @param[in] description A description of the error
 	typedef void(*ErrorCallbackT)(ErrorCode code, const char* param, const char* input, const char* description);
 
+	/// @brief Identifier of a parameter. Ids are given by addParam in consecutive order starting from 0 and
+	/// are stable until freeMem is called.
+	using ParamId = uint32_t;
+	/// @brief Id returned for parameters which do not exist
+	static constexpr ParamId invalidParamId = ~ParamId(0);
+
 	/// Add a info for possible parameter that can come from the command line. All possible parameters must
 	/// be added before calling parse. Calling this does not add a parameter only information.
-	/// @tparam T The type of the parameter. It will be used when parsing the argv to ensure that the passed
-	/// parameters are of type T. Allowed types: bool for flags, int, std::string.
+	/// @param[in] paramT The type of the parameter. It is used when parsing the argv to ensure that the passed
+	/// values have this type. See CMD::CommandLineArgs::Type for the types and the value type each one is read
+	/// as: Flag (bool), Int (int), Int64 (int64_t), UInt64 and Size (uint64_t), Double (double), String
+	/// (std::string or std::string_view), IntList and StringList (std::span). Type::Custom cannot be passed here,
+	/// user types are added with addParam<T>, see CMD::ValueParser.
 	/// @param[in] name The name of the param, must not include - or =.
 	/// @param[in] description The description for the parameter can include everything. This is shown when calling print
 	/// @param[in] required if true the parameter is required. If a parameter is required but not found parse will return error
+	/// @param[out] id If not null and the parameter was added, receives the id of the parameter which can be
+	/// used with getValue to access the value without a name lookup.
 	template<typename NameT, typename DescT> [[nodiscard]]
-	ErrorCode addParam(Type paramT, NameT&& name, DescT&& description, bool required);
+	ErrorCode addParam(Type paramT, NameT&& name, DescT&& description, bool required, ParamId* id = nullptr);
+
+	/// @brief Add a parameter whose value is written directly into a variable when parse finds it. Reading
+	/// the value after parse is plain access to the variable, no lookup is needed. If the parameter is not
+	/// passed the variable keeps its value, thus it can hold the default. The value can still be requested
+	/// with getValue and is part of snapshots. Only the non const parse writes into variables.
+	/// @tparam ValueT Type of the variable, it must match paramT:
+	///		- Int: int, Int64: int64_t, UInt64 and Size: uint64_t, Double: double, Flag: bool, String: std::string
+	///		- IntList: std::vector<int>, StringList: std::vector<std::string>, the vector receives all items
+	/// @param[in] destination The variable, it must outlive the parser or freeMem must be called before it is destroyed
+	/// @return ErrorCode::WrongValueType if ValueT does not match paramT or destination is null, otherwise
+	/// the same as addParam without destination
+	template<typename NameT, typename DescT, typename ValueT> [[nodiscard]]
+	ErrorCode addParam(
+		Type paramT,
+		NameT&& name,
+		DescT&& description,
+		ValueT* destination,
+		bool required,
+		ParamId* id = nullptr
+	);
+
+	/// @brief Add a parameter with user type T, see CMD::ValueParser. parse converts the value once and
+	/// stores it as T, getValue<T> returns the stored value. The type of the parameter is Type::Custom.
+	/// @return The same as addParam with Type
+	template<ParsableValue T, typename NameT, typename DescT> [[nodiscard]]
+	ErrorCode addParam(NameT&& name, DescT&& description, bool required, ParamId* id = nullptr);
+
+	/// @brief Add a parameter with user type T whose value is also written into a variable, see addParam
+	/// with destination. The variable is assigned the value stored by parse.
+	/// @return ErrorCode::WrongValueType if destination is null, otherwise the same as addParam with Type
+	template<ParsableValue T, typename NameT, typename DescT> [[nodiscard]]
+	ErrorCode addParam(NameT&& name, DescT&& description, T* destination, bool required, ParamId* id = nullptr);
+
+	/// @brief Set the one character name of a parameter, e.g. j for jobs. Short options are passed with one
+	/// dash: -j8 or -j 8, flags can be bundled as in -vx and the last option of a bundle can take a value,
+	/// e.g. -vj8. Each character is found with one read from a table with 256 entries.
+	/// @param[in] id The id of the parameter
+	/// @param[in] shortName A letter or a digit, '\0' removes the short name of the parameter
+	/// @return ErrorCode::UnknownParameter if there is no parameter with this id, ErrorCode::ParameterExists
+	/// if another parameter has this short name, ErrorCode::WrongParamFormat if shortName is not a letter or
+	/// a digit, ErrorCode::Success otherwise
+	[[nodiscard]]
+	ErrorCode setShortName(ParamId id, char shortName);
+
+	/// @brief Builds the parameters of a subcommand. It receives an empty parser which uses the memory
+	/// resource and the StringStorage of the parent parser.
+	/// @return ErrorCode::Success or the error from addParam, it is returned by parse
+	using SubcommandFactoryT = std::function<ErrorCode(CommandLineArgs&)>;
+
+	/// @brief Add a subcommand, e.g. build in "tool --verbose build --jobs=8".
+	///
+	/// When the parser has subcommands, parse reads the parameters of the parser until the first argument
+	/// which does not start with - or @. This argument is the name of the subcommand, the rest of the arguments
+	/// are parsed by the parser of the subcommand. Thus each subcommand has its own help and required
+	/// parameters. The parser of a subcommand is built by the factory the first time the subcommand is passed,
+	/// subcommands which are not used cost only their name and factory. Subcommands are only supported by
+	/// the non const parse.
+	/// @param[in] name The name of the subcommand
+	/// @param[in] description Shown by getDescription
+	/// @param[in] factory Adds the parameters of the subcommand
+	/// @return ErrorCode::ParameterExists if there is a subcommand with the same name, ErrorCode::Success otherwise
+	template<typename NameT, typename DescT> [[nodiscard]]
+	ErrorCode addSubcommand(NameT&& name, DescT&& description, SubcommandFactoryT factory);
+
+	/// @brief Get the parser of the subcommand passed to the last parse
+	/// @return The parser of the subcommand or null if no subcommand was parsed
+	CommandLineArgs* getSubcommand();
+	/// @brief Get the parser of the subcommand passed to the last parse
+	/// @return The parser of the subcommand or null if no subcommand was parsed
+	const CommandLineArgs* getSubcommand() const;
+	/// @brief Get the name of the subcommand passed to the last parse, empty if no subcommand was parsed
+	std::string_view getSubcommandName() const;
+
+	/// @brief Receives a positional argument during parse, as soon as it is found
+	/// @return ErrorCode::Success to continue parsing, any other code stops parse which returns it
+	using PositionalCallbackT = std::function<ErrorCode(std::string_view)>;
+
+	/// @brief Accept positional arguments and pass each one to callback during parse.
+	///
+	/// When positional arguments are accepted (by a callback or setCollectPositionals) each argument which
+	/// does not start with -- is positional, as well as all arguments after --. Otherwise they are an error.
+	/// Positional arguments are not stored unless setCollectPositionals is used, the callback can process
+	/// them while parse continues with the following arguments. With StringStorage::View the argument
+	/// points into argv, otherwise it is valid only during the call. The const parse can call the callback
+	/// from multiple threads at the same time.
+	/// @param[in] callback The callback or null to stop accepting positional arguments
+	void setPositionalCallback(PositionalCallbackT callback);
+	/// @brief Store positional arguments so that they can be read with getPositionals after parse
+	void setCollectPositionals(bool collect);
+	/// @brief Get the positional arguments stored by parse, see setCollectPositionals
+	std::span<const std::string_view> getPositionals() const {
+		return valueStore->values.positionals.view;
+	}
+
+	/// @brief Checks a value of a parameter after it was converted, e.g. that a path exists or a port is free
+	/// @param[in] value The value as it was passed, for lists the whole comma separated list
+	/// @param[out] message Description of the problem, used when the value is rejected
+	/// @return true if the value is valid
+	using ValidatorT = std::function<bool(std::string_view value, std::string& message)>;
+
+	/// @brief Value rejected by a validator
+	struct ValidationError {
+		ParamId id;
+		/// The value as it was passed
+		std::string value;
+		/// The message set by the validator
+		std::string message;
+	};
+
+	/// @brief Set the validator of a parameter. It is called for each value of the parameter passed to parse,
+	/// after all arguments are parsed and all required parameters are found. All values are validated, parse
+	/// does not stop at the first rejected one. Each rejected value is passed to the error callback and
+	/// parse returns ErrorCode::ValidationFailed. Validators must not throw. They can be called from
+	/// multiple threads at the same time, see setValidationThreads. Flags are not validated.
+	/// @param[in] id The id of the parameter
+	/// @param[in] validator The validator or null to remove it
+	/// @return ErrorCode::UnknownParameter if there is no parameter with this id, ErrorCode::Success otherwise
+	[[nodiscard]]
+	ErrorCode setValidator(ParamId id, ValidatorT validator);
+	/// @brief Values validated by one parse, below which the validators run on the calling thread whatever
+	/// setValidationThreads says. Starting threads costs more than validating a few values.
+	static constexpr std::size_t parallelValidationThreshold = 64;
+	/// @brief Set how many threads run the validators. Values are split between the calling thread and
+	/// threadCount - 1 threads started for each parse, which are joined before parse returns. Parses with
+	/// fewer than parallelValidationThreshold values to validate do not start threads.
+	/// @param[in] threadCount Number of threads (including the calling thread), 0 means one thread per
+	/// hardware thread. The default is 1, validators run on the calling thread.
+	void setValidationThreads(unsigned threadCount);
+	/// @brief Get the values rejected during the last non const parse, in the order they were passed.
+	/// The const parse overloads return them through their validationErrors parameter.
+	std::span<const ValidationError> getValidationErrors() const {
+		return validationErrors;
+	}
+
+	/// @brief Get the id of a parameter
+	/// @param[in] param The name of the parameter
+	/// @return The id of the parameter or CMD::CommandLineArgs::invalidParamId if there is no such parameter
+	ParamId getParamId(std::string_view param) const;
 
 	/// @brief Get the value of a parameter
 	/// @tparam ParamT The type of the parameter. One of CMD::CommandLineArgs::Type.
@@ -167,10 +651,42 @@ public:
 	///		- If the parameter was not passed, then the pointer is valid and points to false.
 	/// - If the types don't match or the parameter was not passed (except for the case of bool parameters)
 	///   then return nullptr.
+	/// - String parameters are returned as std::string when the parser uses StringStorage::Copy and as
+	///   std::string_view when it uses StringStorage::View. Requesting the other one returns nullptr.
+	template<Type ParamT, typename OutT = TypeMatch<ParamT>::type>
+	const OutT* getValue(std::string_view param) const;
+
+	/// @brief Get the value of a parameter by the id returned from addParam. Works the same as getValue
+	/// by name, but does not search for the parameter. Invalid ids return nullptr.
 	template<Type ParamT, typename OutT = TypeMatch<ParamT>::type>
-	const OutT* getValue(const std::string& param);
+	const OutT* getValue(ParamId id) const;
+
+	/// @brief Get the value of a parameter added with addParam<T>
+	/// @return Pointer to the value or nullptr if the parameter was not passed or was not added with type T
+	template<ParsableValue T>
+	const T* getValue(std::string_view param) const {
+		return getValue<T>(getParamId(param));
+	}
+
+	/// @brief Get the value of a parameter added with addParam<T> by id
+	template<ParsableValue T>
+	const T* getValue(ParamId id) const {
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+		recordAccess(id);
+#endif
+		return readCustom<T>(*paramTable, valueStore->values, id);
+	}
 
 	/// @brief Parse command line arguments that are parameters passed to main function.
+	///
+	/// A parameter which is not a flag takes its value as --name=value or from the next argument as
+	/// --name value. Parameters with a short name (see setShortName) can also be passed as -j8 or -j 8
+	/// and flags can be bundled as -vx.
+	///
+	/// An argument @path is a response file. The file is mapped in memory and its arguments are parsed as
+	/// if they were passed in place of @path. Arguments in the file are separated by whitespace and can be
+	/// quoted with ' or " as in a shell. Response files can include other response files. With
+	/// StringStorage::View string values point into the mapped file, which is kept until freeValues.
 	/// @param[in] numArgs The number of the arguments
 	/// @param[in] args An array of arguments that comes from main function where
 	/// args[0] is the name of the program, args[1] is the first argument and so on.
@@ -178,9 +694,233 @@ public:
 	/// @returns The code of the first error encountered during the parsing or ErrorCode::Success in case of no errors
 	[[nodiscard]]
 	ErrorCode parse(const int numArgs, char** args, ErrorCallbackT errorCallback = nullptr);
-	/// @brief Show the parameters with their description
-	/// @param[in,out] f File stream where parameters will be printed
+	/// @brief Parse arguments given as one string, e.g. --threads=8 --out="/data/x y", without the name of
+	/// the program.
+	///
+	/// The string is split as by a shell and as response files are: arguments are separated by whitespace,
+	/// ' and " quote and a backslash escapes the next character. The string is copied once, split in place
+	/// and each argument is parsed as soon as it is found, no array of arguments is built. Response files,
+	/// -- and positional arguments work as in argv. With StringStorage::View string values point into the
+	/// copy, which is kept until freeValues, thus the string does not need to outlive the parse. Subcommands
+	/// are not parsed, the string holds the parameters of this parser only.
+	/// @param[in] commandLine The arguments
+	/// @param[in] errorCallback A function which will be called if an error in the parsing happens
+	/// @returns ErrorCode::UnclosedQuote if a quote is not closed, otherwise the same as parse with argv
+	[[nodiscard]]
+	ErrorCode parse(std::string_view commandLine, ErrorCallbackT errorCallback = nullptr);
+	/// @brief Where the value of a parameter comes from. Each source overrides the ones before it.
+	enum class Source : uint8_t {
+		Default, ///< Not set by parse, the parameter has no value or the bound variable keeps its default
+		ConfigFile, ///< Config file, see CMD::CommandLineArgs::Sources
+		Environment, ///< Environment variable, see CMD::CommandLineArgs::Sources
+		CommandLine ///< argv or a response file passed in argv
+	};
+
+	/// @brief Sources of values read by parse before argv
+	struct Sources {
+		/// Path to a config file or null. Each line is key=value where key is the name of a parameter,
+		/// keys after a line [section] are named section.key. Lines starting with # or ; are comments.
+		/// Whitespace around keys and values is ignored, a value can be quoted with ' or ". Flags take
+		/// true, false, yes, no, on, off, 1 or 0, a key without value sets the flag. The file is mapped in
+		/// memory and read in place, with StringStorage::View string values point into it.
+		const char* configFile = nullptr;
+		/// Prefix of the environment variables or null to not read the environment. The variable of a
+		/// parameter is the prefix followed by the name in upper case with all characters other than
+		/// letters and digits replaced by _, e.g. "APP_" and log-level give APP_LOG_LEVEL. Flags take the
+		/// same values as in the config file. With StringStorage::View string values point into the environment.
+		const char* environmentPrefix = nullptr;
+	};
+
+	/// @brief Parse the config file, then the environment and then argv. Values from later sources override
+	/// values from earlier ones, a list from a later source replaces the list instead of appending to it.
+	/// Required parameters can come from any source. The source of each value is returned by getSource.
+	/// @param[in] numArgs The number of the arguments
+	/// @param[in] args An array of arguments, where args[0] is the name of the program
+	/// @param[in] sources The config file and environment to read
+	/// @param[in] errorCallback A function which will be called if an error in the parsing happens
+	/// @returns The code of the first error encountered during the parsing or ErrorCode::Success in case of no errors
+	[[nodiscard]]
+	ErrorCode parse(const int numArgs, char** args, const Sources& sources, ErrorCallbackT errorCallback = nullptr);
+	/// @brief Get where the value of a parameter came from
+	/// @return The source or Source::Default if the parameter was not set or the id is invalid
+	Source getSource(ParamId id) const {
+		return getSourceOf(valueStore->values, id);
+	}
+
+	/// @brief Parse command line arguments into a new immutable snapshot. Does not modify the parser, thus
+	/// it can be called from multiple threads at the same time.
+	/// @param[in] numArgs The number of the arguments
+	/// @param[in] args An array of arguments, where args[0] is the name of the program
+	/// @param[out] out Receives the parsed values on success, set to null on error
+	/// @param[in] errorCallback A function which will be called if an error in the parsing happens
+	/// @param[out] validationErrors Receives the values rejected by validators, in the order they were passed. It is
+	/// cleared first. Can be null.
+	/// @returns The code of the first error encountered during the parsing or ErrorCode::Success in case of no errors
+	[[nodiscard]]
+	ErrorCode parse(
+		const int numArgs,
+		char** args,
+		std::shared_ptr<const ParsedArgs>& out,
+		ErrorCallbackT errorCallback = nullptr,
+		std::vector<ValidationError>* validationErrors = nullptr
+	) const;
+	/// @brief Parse the sources and argv into a new immutable snapshot. Works as the non const parse with
+	/// sources, but does not modify the parser.
+	/// @param[in] numArgs The number of the arguments
+	/// @param[in] args An array of arguments, where args[0] is the name of the program
+	/// @param[in] sources The config file and environment to read
+	/// @param[out] out Receives the parsed values on success, set to null on error
+	/// @param[in] errorCallback A function which will be called if an error in the parsing happens
+	/// @param[out] validationErrors Receives the values rejected by validators, in the order they were passed. It is
+	/// cleared first. Can be null.
+	/// @returns The code of the first error encountered during the parsing or ErrorCode::Success in case of no errors
+	[[nodiscard]]
+	ErrorCode parse(
+		const int numArgs,
+		char** args,
+		const Sources& sources,
+		std::shared_ptr<const ParsedArgs>& out,
+		ErrorCallbackT errorCallback = nullptr,
+		std::vector<ValidationError>* validationErrors = nullptr
+	) const;
+	/// @brief Parse arguments given as one string into a new immutable snapshot. Works as the non const parse
+	/// of a string, but does not modify the parser, thus many strings can be parsed from multiple threads.
+	/// @param[in] commandLine The arguments, without the name of the program
+	/// @param[out] out Receives the parsed values on success, set to null on error
+	/// @param[in] errorCallback A function which will be called if an error in the parsing happens
+	/// @param[out] validationErrors Receives the values rejected by validators, in the order they were passed. It is
+	/// cleared first. Can be null.
+	/// @returns The code of the first error encountered during the parsing or ErrorCode::Success in case of no errors
+	[[nodiscard]]
+	ErrorCode parse(
+		std::string_view commandLine,
+		std::shared_ptr<const ParsedArgs>& out,
+		ErrorCallbackT errorCallback = nullptr,
+		std::vector<ValidationError>* validationErrors = nullptr
+	) const;
+
+	/// @brief One argument vector passed to CMD::CommandLineArgs::parseBatch
+	struct Arguments {
+		int numArgs;
+		char** args;
+	};
+
+	/// @brief Result of parsing one argument vector with CMD::CommandLineArgs::parseBatch
+	struct BatchResult {
+		/// The code of the first error in the argument vector or ErrorCode::Success
+		ErrorCode code = ErrorCode::Success;
+		/// The parsed values, null if code is not ErrorCode::Success
+		std::shared_ptr<const ParsedArgs> args;
+		/// Values rejected by validators, in the order they were passed
+		std::vector<ValidationError> validationErrors;
+	};
+
+	/// @brief Parse many argument vectors against the parameters of this parser in parallel. The parameter
+	/// info is shared read only between all threads and all results.
+	/// @param[in] inputs The argument vectors to parse
+	/// @param[in] threadCount Number of threads to use (including the calling thread), 0 means one
+	/// thread per hardware thread
+	/// @param[in] errorCallback Called for each error. It can be called from multiple threads at the same time.
+	/// @return One result for each input, in the order of the inputs
+	std::vector<BatchResult> parseBatch(
+		std::span<const Arguments> inputs,
+		unsigned threadCount = 0,
+		ErrorCallbackT errorCallback = nullptr
+	) const;
+
+	/// @brief Counters collected when the library is built with CMD_LINE_ARGS_INSTRUMENTATION defined
+	/// (CMake option CMD_LINE_ARGS_WITH_INSTRUMENTATION). Without it nothing is collected and all counters are 0.
+	struct ParseStats {
+		/// Number of parsed argument vectors, including the const parse and parseBatch
+		uint64_t parseCount = 0;
+		/// Number of parsed arguments, including the arguments in response files
+		uint64_t argumentCount = 0;
+		/// Time spent splitting arguments into name and value and splitting response files into arguments
+		std::chrono::nanoseconds tokenizeTime{0};
+		/// Time spent searching parameters by name
+		std::chrono::nanoseconds lookupTime{0};
+		/// Time spent converting and storing values
+		std::chrono::nanoseconds convertTime{0};
+		/// Time spent checking that all required parameters were passed
+		std::chrono::nanoseconds requiredCheckTime{0};
+		/// Allocations made from the arena of the parser by the non const parse. Values parsed by the const
+		/// parse and strings copied with StringStorage::Copy do not use the arena and are not counted.
+		uint64_t allocationCount = 0;
+		/// Bytes allocated from the arena of the parser by the non const parse
+		uint64_t allocatedBytes = 0;
+		/// Number of lookups by name with getValue or getParamId of parameters which do not exist
+		uint64_t lookupMisses = 0;
+	};
+
+	/// @brief Receives events as they happen. Only called when the library is built with
+	/// CMD_LINE_ARGS_INSTRUMENTATION. The const functions of the parser can call the observer from
+	/// multiple threads at the same time.
+	class ParseObserver {
+	public:
+		virtual ~ParseObserver() = default;
+		/// @brief Called at the end of each parse with the stats of this parse only
+		virtual void onParse(const ParseStats&) { }
+		/// @brief Called when getValue is called for an existing parameter
+		virtual void onAccess(ParamId) { }
+		/// @brief Called when a lookup by name does not find a parameter
+		virtual void onLookupMiss(std::string_view) { }
+	};
+
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+	static constexpr bool instrumentationEnabled = true;
+#else
+	static constexpr bool instrumentationEnabled = false;
+#endif
+
+	/// @brief Get the counters collected since the parser was created or since resetStats
+	ParseStats getStats() const;
+	/// @brief Get how many times getValue was called for a parameter. It shows which parameters are read
+	/// often and are worth caching or binding to a variable.
+	uint64_t getAccessCount(ParamId id) const;
+	/// @brief Set all counters, including the access counts, to 0
+	void resetStats();
+	/// @brief Set the observer which receives the events, null to remove it. The observer must outlive the parser.
+	void setObserver(ParseObserver* observer);
+
+	/// @brief Create immutable copy of the currently parsed values. The parameter info is shared
+	/// with the parser, it is copied only if addParam is called while the snapshot is alive.
+	/// @return Snapshot which can be read from multiple threads without synchronization
+	std::shared_ptr<const ParsedArgs> snapshot() const;
+	/// @brief Write the parameters and the currently parsed values in a binary blob which can be read in place
+	/// by CMD::SerializedArgs, e.g. in a child process which maps it from shared memory. The blob does not
+	/// contain pointers, it can be placed at any address aligned to 8 bytes. Descriptions, bound variables,
+	/// subcommands, validators and values of Type::Custom parameters are not written.
+	std::vector<std::byte> serialize() const;
+	/// @brief Get the help: usage, then the parameters and the subcommands sorted by name with their descriptions
+	/// aligned in one column and wrapped at the width set with setHelpWidth. The text is generated on the first
+	/// call and cached until a parameter, a subcommand, a short name, the width or the name of the program changes.
+	/// @return View of the cached text, valid until the help changes or the parser is destroyed
+	std::string_view getHelp() const;
+	/// @brief Same as getHelp, returns a copy of the text
 	std::string getDescription() const;
+	/// @brief Write the help in a file, e.g. stdout, with one call to fwrite
+	void printHelp(std::FILE* file) const;
+	/// @brief Write the help in a stream with one call to write
+	void printHelp(std::ostream& stream) const;
+	/// @brief Copy the help to an output iterator, e.g. a char buffer or std::back_inserter of a string
+	/// @return The iterator past the last written character
+	template<std::output_iterator<char> OutputIt>
+	OutputIt printHelp(OutputIt out) const {
+		const std::string_view help = getHelp();
+		return std::copy(help.begin(), help.end(), out);
+	}
+	/// @brief Set the width in characters at which descriptions in the help are wrapped. Default is 80,
+	/// 0 disables wrapping.
+	void setHelpWidth(unsigned columns);
+	/// @brief Generate a script which completes the options and subcommands in the shell without running the
+	/// program. Values of Type::String parameters are completed as file names. Subcommands which were not
+	/// parsed yet are built with their factories on temporary parsers to read their options.
+	/// The bash script is loaded with source, the zsh script can be loaded with source or placed in fpath
+	/// as _command.
+	/// @param[in] shell The shell which runs the script
+	/// @param[in] command The name of the command to complete, the file name of argv[0] from the last parse if empty
+	/// @return The text of the script
+	std::string getCompletionScript(Shell shell, std::string_view command = {}) const;
 	/// @brief Delete all parameters as well as all parameter info
 	void freeMem();
 	/// @brief Delete only the parameters, without deleting the info
@@ -197,69 +937,1064 @@ private:
 			return Type::String;
 		} else if constexpr (std::is_same_v<T, bool>) {
 			return Type::Flag;
+		} else if constexpr (std::is_same_v<T, int64_t>) {
+			return Type::Int64;
+		} else if constexpr (std::is_same_v<T, uint64_t>) {
+			return Type::UInt64;
+		} else if constexpr (std::is_same_v<T, double>) {
+			return Type::Double;
+		} else if constexpr (std::is_same_v<T, std::span<const int>>) {
+			return Type::IntList;
+		} else if constexpr (std::is_same_v<T, std::span<const std::string_view>>) {
+			return Type::StringList;
 		} else {
 			static_assert(sizeof(T) < 0, "Unknown type");
 		}
 	}
 
-	/// @brief Internal structure to hold information about each parameter
-	struct ParamInfo {
-		ParamInfo() = default;
-		template<typename DescT>
-		ParamInfo(DescT&& description, const Type type, const bool required) :
-			description(std::forward<DescT>(description)),
-			type(type),
-			required(required)
+	/// @brief Check if a variable of type ValueT can receive the values of parameter with type paramT
+	template<typename ValueT>
+	static constexpr bool canBind(Type paramT) {
+		switch (paramT) {
+			case Type::Int: return std::is_same_v<ValueT, int>;
+			case Type::String: return std::is_same_v<ValueT, std::string>;
+			case Type::Flag: return std::is_same_v<ValueT, bool>;
+			case Type::Int64: return std::is_same_v<ValueT, int64_t>;
+			case Type::UInt64:
+			case Type::Size: return std::is_same_v<ValueT, uint64_t>;
+			case Type::Double: return std::is_same_v<ValueT, double>;
+			case Type::IntList: return std::is_same_v<ValueT, std::vector<int>>;
+			case Type::StringList: return std::is_same_v<ValueT, std::vector<std::string>>;
+			case Type::Custom: return false;
+		}
+		return false;
+	}
+
+	/// @brief Hash which allows looking up std::string keys by std::string_view without
+	/// constructing a temporary std::string.
+	struct NameHash {
+		using is_transparent = void;
+		std::size_t operator()(std::string_view name) const {
+			return std::hash<std::string_view>()(name);
+		}
+	};
+
+	/// @brief Bitset with one bit per parameter
+	struct ParamBitset {
+		explicit ParamBitset(std::pmr::memory_resource* resource) :
+			words(resource)
 		{ }
-		/// Description of the parameter. Printed when CommandLineArgs::print is called
-		std::string description;
+
+		ParamBitset(const ParamBitset& other, std::pmr::memory_resource* resource) :
+			words(other.words, resource)
+		{ }
+
+		void resize(std::size_t bits) {
+			words.resize((bits + 63) / 64, 0);
+		}
+
+		void set(std::size_t i) {
+			words[i / 64] |= uint64_t(1) << (i % 64);
+		}
+
+		void reset(std::size_t i) {
+			words[i / 64] &= ~(uint64_t(1) << (i % 64));
+		}
+
+		bool test(std::size_t i) const {
+			return words[i / 64] & (uint64_t(1) << (i % 64));
+		}
+
+		void reset() {
+			std::fill(words.begin(), words.end(), 0);
+		}
+
+		/// @brief Find the first bit which is set in this, but not in other
+		/// @return Index of the bit or -1 if there is no such bit
+		int64_t firstAndNot(const ParamBitset& other) const {
+			for (std::size_t i = 0; i < words.size(); ++i) {
+				const uint64_t word = words[i] & ~other.words[i];
+				if (word) {
+					return int64_t(i * 64 + std::countr_zero(word));
+				}
+			}
+			return -1;
+		}
+
+		std::pmr::vector<uint64_t> words;
+	};
+
+	/// @brief Information about all parameters. Stored as structure of arrays indexed by ParamId.
+	/// Everything is allocated from the memory resource passed to the constructor.
+	struct ParamTable {
+		explicit ParamTable(std::pmr::memory_resource* resource) :
+			names(resource),
+			descriptions(resource),
+			types(resource),
+			columns(resource),
+			required(resource),
+			ids(resource),
+			customTypes(resource),
+			shortNames(resource)
+		{
+			shortIds.fill(invalidParamId);
+		}
+
+		ParamTable(const ParamTable& other, std::pmr::memory_resource* resource) :
+			names(other.names, resource),
+			descriptions(other.descriptions, resource),
+			types(other.types, resource),
+			columns(other.columns, resource),
+			required(other.required, resource),
+			ids(other.ids, resource),
+			customTypes(other.customTypes, resource),
+			shortNames(other.shortNames, resource),
+			shortIds(other.shortIds),
+			intCount(other.intCount),
+			int64Count(other.int64Count),
+			uint64Count(other.uint64Count),
+			doubleCount(other.doubleCount),
+			stringCount(other.stringCount),
+			intListCount(other.intListCount),
+			stringListCount(other.stringListCount)
+		{ }
+
+		/// Name of each parameter without the dashes
+		std::pmr::vector<std::pmr::string> names;
+		/// Description of the parameter. Printed when CommandLineArgs::getDescription is called
+		std::pmr::vector<std::pmr::string> descriptions;
 		/// Internal type of parameter. Used when the value is parsed. Matches to at least
 		/// one C++ type.
-		Type type;
+		std::pmr::vector<Type> types;
+		/// Index of the value of the parameter in the value column for its type
+		std::pmr::vector<uint32_t> columns;
 		/// If the parameter is required and not passed the parse will fail.
-		bool required;
+		ParamBitset required;
+		/// Maps parameter name to its id
+		std::pmr::unordered_map<std::pmr::string, ParamId, NameHash, std::equal_to<>> ids;
+		/// Type of each Custom parameter, indexed by its column. The size is the number of Custom parameters.
+		std::pmr::vector<const detail::CustomType*> customTypes;
+		/// One character name of each parameter or '\0', indexed by ParamId
+		std::pmr::vector<char> shortNames;
+		/// Maps each one character name to its parameter, so that -x is found with one array read
+		std::array<ParamId, 256> shortIds;
+		/// Number of parameters stored in each column, used to give column index to new parameters
+		uint32_t intCount = 0;
+		uint32_t int64Count = 0;
+		/// UInt64 and Size parameters
+		uint32_t uint64Count = 0;
+		uint32_t doubleCount = 0;
+		uint32_t stringCount = 0;
+		uint32_t intListCount = 0;
+		uint32_t stringListCount = 0;
+	};
+
+	/// @brief Values of one IntList parameter
+	struct IntList {
+		using allocator_type = std::pmr::polymorphic_allocator<>;
+
+		explicit IntList(const allocator_type& allocator = {}) :
+			items(allocator)
+		{ }
+
+		IntList(const IntList& other, const allocator_type& allocator = {}) :
+			items(other.items, allocator),
+			view(items)
+		{ }
+
+		IntList(IntList&& other, const allocator_type& allocator) :
+			items(std::move(other.items), allocator),
+			view(items)
+		{ }
+
+		IntList(IntList&& other) noexcept :
+			items(std::move(other.items)),
+			view(items)
+		{ }
+
+		std::pmr::vector<int> items;
+		/// View over items, it is what getValue returns
+		std::span<const int> view;
+	};
+
+	/// @brief Values of one StringList parameter
+	struct StringList {
+		using allocator_type = std::pmr::polymorphic_allocator<>;
+
+		explicit StringList(const allocator_type& allocator = {}) :
+			buffer(allocator),
+			ends(allocator),
+			items(allocator)
+		{ }
+
+		StringList(const StringList& other, const allocator_type& allocator = {}) :
+			buffer(other.buffer, allocator),
+			ends(other.ends, allocator),
+			items(other.items, allocator)
+		{
+			updateItems(0);
+		}
+
+		StringList(StringList&& other, const allocator_type& allocator) :
+			buffer(std::move(other.buffer), allocator),
+			ends(std::move(other.ends), allocator),
+			items(std::move(other.items), allocator)
+		{
+			updateItems(0);
+		}
+
+		StringList(StringList&& other) noexcept :
+			buffer(std::move(other.buffer)),
+			ends(std::move(other.ends)),
+			items(std::move(other.items))
+		{
+			updateItems(0);
+		}
+
+		/// @brief Point items to the strings in buffer, starting from item with index first.
+		/// Does nothing for items which are views into argv.
+		void updateItems(std::size_t first);
+
+		/// Copied strings one after another. Empty when the strings are views into argv.
+		std::pmr::string buffer;
+		/// End offset of each copied string in the buffer
+		std::pmr::vector<std::size_t> ends;
+		/// Views to the strings in the buffer or in argv
+		std::pmr::vector<std::string_view> items;
+		/// View over items, it is what getValue returns
+		std::span<const std::string_view> view;
+	};
+
+	/// @brief Parsed values. Each type has one contiguous column. Which type is used for string
+	/// parameters depends on the StringStorage.
+	struct ParamValues {
+		/// @brief Create columns with size matching the parameters in the table
+		ParamValues(const ParamTable& table, StringStorage storage, std::pmr::memory_resource* resource);
+		/// Copies use the default memory resource, so that they do not depend on the arena of the parser
+		ParamValues(const ParamValues&) = default;
+		/// Moves keep the memory resource of the source and take its columns without copying
+		ParamValues(ParamValues&&) noexcept = default;
+		ParamValues& operator=(const ParamValues&) = default;
+		ParamValues& operator=(ParamValues&&) = default;
+
+		/// @brief Resize the columns to match the parameters in the table
+		void resize(const ParamTable& table, StringStorage storage);
+
+		std::pmr::vector<int> ints;
+		std::pmr::vector<int64_t> int64s;
+		std::pmr::vector<uint64_t> uint64s;
+		std::pmr::vector<double> doubles;
+		std::pmr::vector<std::string> strings;
+		std::pmr::vector<std::string_view> stringViews;
+		std::pmr::vector<IntList> intLists;
+		std::pmr::vector<StringList> stringLists;
+		std::pmr::vector<detail::CustomValue> customs;
+		/// Positional arguments, if they are collected
+		StringList positionals;
+		/// Bit for each parameter, set if the parameter was passed
+		ParamBitset present;
+		/// Source of the value of each parameter, indexed by ParamId
+		std::pmr::vector<Source> sources;
+		/// Response files which string views point into
+		std::pmr::vector<std::shared_ptr<const detail::MappedFile>> files;
+	};
+	static_assert(std::is_nothrow_move_constructible_v<ParamValues>, "Moving parsed values must not copy the columns");
+
+	/// @brief Parsed values together with the arena they are allocated from. Kept behind a pointer so that
+	/// moving the parser does not move the arena away from the containers which use it.
+	struct ValueStore {
+		ValueStore(const ParamTable& table, StringStorage storage, std::pmr::memory_resource* upstream) :
+			arena(upstream),
+			values(table, storage, &arena)
+		{ }
+		ArenaResource arena;
+		ParamValues values;
+	};
+
+	/// @brief Get the column for values of type OutT. The constness of the result matches the values.
+	template<typename OutT, typename ValuesT>
+	static auto& getColumn(ValuesT& values) {
+		if constexpr (std::is_same_v<OutT, int>) {
+			return values.ints;
+		} else if constexpr (std::is_same_v<OutT, int64_t>) {
+			return values.int64s;
+		} else if constexpr (std::is_same_v<OutT, uint64_t>) {
+			return values.uint64s;
+		} else if constexpr (std::is_same_v<OutT, double>) {
+			return values.doubles;
+		} else if constexpr (std::is_same_v<OutT, std::span<const int>>) {
+			return values.intLists;
+		} else if constexpr (std::is_same_v<OutT, std::span<const std::string_view>>) {
+			return values.stringLists;
+		} else if constexpr (std::is_same_v<OutT, std::string>) {
+			return values.strings;
+		} else if constexpr (std::is_same_v<OutT, std::string_view>) {
+			return values.stringViews;
+		} else {
+			static_assert(sizeof(OutT) < 0, "Unknown type");
+		}
+	}
+
+	/// @brief How positional arguments are handled
+	struct Positionals {
+		PositionalCallbackT callback;
+		bool collect;
 	};
 
-	using ParamVal = std::variant<std::string, int, bool>;
+	/// @brief Arguments of one parse, argv or a command line passed as one string
+	struct Input {
+		int numArgs = 0;
+		char** args = nullptr;
+		/// Copy of the command line, split in place while it is parsed. Null when the arguments are in args.
+		std::shared_ptr<detail::MappedFile> commandLine;
+	};
+
+	/// @brief Writes values found by the parser into ParamValues
+	struct ParseTarget;
+	/// @brief Values which have a validator, collected during parse and validated after it
+	struct Validations;
+
+	/// @brief Parse argv into values. Used by all overloads of parse.
+	/// @param[in] bindings Variables bound to the parameters, indexed by ParamId. Null if the values
+	/// must not be written into the variables.
+	/// @param[in,out] stats Receives the phase timings, null if they are not collected
+	/// @param[in,out] validations Receives the values to validate, null if no parameter has a validator
+	static ErrorCode parseInto(
+		const ParamTable& table,
+		ParamValues& values,
+		StringStorage stringStorage,
+		void* const* bindings,
+		ParseStats* stats,
+		const Positionals& positionals,
+		Validations* validations,
+		const Sources& sources,
+		const Input& input,
+		ErrorCallbackT errorCallback
+	);
+
+	/// @brief Parse argv into values and run the validators. Used by both overloads of parse.
+	/// @param[out] errors Receives the rejected values, can be null
+	ErrorCode parseAndValidate(
+		ParamValues& values,
+		void* const* bindings,
+		ParseStats* stats,
+		std::vector<ValidationError>* errors,
+		const Sources& sources,
+		const Input& input,
+		ErrorCallbackT errorCallback
+	) const;
+
+	/// @brief Parse into the values of the parser and record the stats. Used by the non const parse overloads.
+	ErrorCode parseValues(const Input& input, const Sources& sources, ErrorCallbackT errorCallback);
+
+	/// @brief Parse into a new snapshot. Used by the const parse overloads.
+	ErrorCode parseSnapshot(
+		const Input& input,
+		const Sources& sources,
+		std::shared_ptr<const ParsedArgs>& out,
+		ErrorCallbackT errorCallback,
+		std::vector<ValidationError>* validationErrors
+	) const;
+
+	/// @brief Parse argv without taking the name of the program from args[0]. Subcommands are parsed with it,
+	/// their name is set once by the parent.
+	ErrorCode parseArgv(const int numArgs, char** args, const Sources& sources, ErrorCallbackT errorCallback);
+
+	/// @brief Parse the arguments which follow the parameters of the parser, starting with the name of the subcommand
+	ErrorCode parseSubcommand(const int numArgs, char** args, ErrorCallbackT errorCallback);
+
+	/// @brief Set the name shown in the help. Built subcommands are renamed to "name subcommand". Does nothing
+	/// if the name is the same, so that the cached help is kept.
+	void setProgramName(std::string_view name);
+
+	/// @brief Implementation of getValue shared with ParsedArgs
+	template<Type ParamT, typename OutT>
+	static const OutT* readValue(const ParamTable& table, const ParamValues& values, ParamId id);
 
-	std::unordered_map<std::string, ParamInfo> paramInfo;
-	std::unordered_map<std::string, ParamVal> paramValues;
-	mutable std::string description;
-	std::string programName;
+	/// @brief Implementation of getValue<T> shared with ParsedArgs
+	template<ParsableValue T>
+	static const T* readCustom(const ParamTable& table, const ParamValues& values, ParamId id) {
+		if (id >= table.types.size() || table.types[id] != Type::Custom || !values.present.test(id)) {
+			return nullptr;
+		}
+		const detail::CustomValue& value = values.customs[table.columns[id]];
+		return value.getType() == &detail::customTypeOf<T> ? static_cast<const T*>(value.get()) : nullptr;
+	}
+
+	/// @brief Add a parameter of any type. customType is the type of Custom parameters, null otherwise.
+	template<typename NameT, typename DescT>
+	ErrorCode insertParam(
+		Type paramT,
+		NameT&& name,
+		DescT&& description,
+		bool required,
+		const detail::CustomType* customType,
+		ParamId* id
+	);
+
+	static ParamId findParamId(const ParamTable& table, std::string_view param);
+	/// @brief Ids of the parameters in order of their names
+	static std::vector<ParamId> sortedByName(const ParamTable& table);
+
+	/// @brief Check if arg names a parameter whose value is the next argument, e.g. --jobs 8 or -j 8
+	static bool takesNextArgument(const ParamTable& table, const char* arg);
+
+	static Source getSourceOf(const ParamValues& values, ParamId id) {
+		return id < values.sources.size() ? values.sources[id] : Source::Default;
+	}
+
+	/// @brief Implementation of serialize shared with ParsedArgs
+	static std::vector<std::byte> serialize(const ParamTable& table, const ParamValues& values);
+
+	/// @brief Implementation of ParsedArgs::changedParams
+	static std::vector<ParamId> changedParams(
+		const ParamTable& table,
+		const ParamValues& values,
+		const ParamTable& otherTable,
+		const ParamValues& otherValues
+	);
+
+	/// @brief Get the param table for modification. Copies the table if it is shared with a snapshot.
+	ParamTable& mutableTable();
+
+	struct Subcommand {
+		std::pmr::string name;
+		std::pmr::string description;
+		SubcommandFactoryT factory;
+		/// Built by the factory the first time the subcommand is parsed
+		std::unique_ptr<CommandLineArgs> args;
+	};
+
+	/// @brief Subcommands in order of adding and their indices by name
+	struct Subcommands {
+		explicit Subcommands(std::pmr::memory_resource* resource) :
+			list(resource),
+			ids(resource)
+		{ }
+
+		std::pmr::vector<Subcommand> list;
+		std::pmr::unordered_map<std::pmr::string, uint32_t, NameHash, std::equal_to<>> ids;
+		/// Index of the subcommand passed to the last parse or -1
+		int active = -1;
+	};
+
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+	/// @brief Counters shared by all threads which use the parser
+	struct Instrumentation {
+		void add(const ParseStats& stats);
+
+		std::atomic<uint64_t> parseCount = 0;
+		std::atomic<uint64_t> argumentCount = 0;
+		std::atomic<int64_t> tokenizeTime = 0;
+		std::atomic<int64_t> lookupTime = 0;
+		std::atomic<int64_t> convertTime = 0;
+		std::atomic<int64_t> requiredCheckTime = 0;
+		std::atomic<uint64_t> allocationCount = 0;
+		std::atomic<uint64_t> allocatedBytes = 0;
+		std::atomic<uint64_t> lookupMisses = 0;
+		/// Number of getValue calls for each parameter, indexed by ParamId. std::deque because
+		/// atomics cannot be moved when the container grows.
+		std::deque<std::atomic<uint64_t>> accessCounts;
+		std::atomic<ParseObserver*> observer = nullptr;
+	};
+
+	/// @brief Count a getValue call for parameter with the given id
+	void recordAccess(ParamId id) const;
+	/// @brief Add the stats of one parse to the counters and notify the observer
+	void recordParse(const ParseStats& stats) const;
+#endif
+
+	friend class ParsedArgs;
+	friend class SerializedArgs;
+	friend struct ParseTarget;
+
+	/// Resource used to allocate everything except parsed values
+	std::pmr::memory_resource* resource;
+	/// Shared with snapshots created by CommandLineArgs::snapshot
+	std::shared_ptr<ParamTable> paramTable;
+	std::unique_ptr<ValueStore> valueStore;
+	/// Variable bound to each parameter or null, indexed by ParamId. Not shared with snapshots.
+	std::pmr::vector<void*> bindings;
+	Subcommands subcommands;
+	Positionals positionals;
+	/// Validator of each parameter or null, indexed by ParamId
+	std::pmr::vector<ValidatorT> validators;
+	/// Number of parameters with a validator
+	uint32_t validatorCount;
+	unsigned validationThreads;
+	std::vector<ValidationError> validationErrors;
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+	std::unique_ptr<Instrumentation> instrumentation;
+#endif
+	mutable std::pmr::string description;
+	std::pmr::string programName;
 	mutable bool descriptionGenerated;
+	unsigned helpWidth;
+	StringStorage stringStorage;
 };
 
-template<CommandLineArgs::Type ParamT, typename OutT>
-const OutT* CommandLineArgs::getValue(const std::string& param) {
-	auto it = paramValues.find(param);
-
-	if (it == paramValues.end()) {
-		if constexpr (ParamT == Type::Flag) {
-			const auto infoIt = paramInfo.find(param);
-			if (infoIt != paramInfo.end() && infoIt->second.type == Type::Flag) {
-				return &std::get<bool>((paramValues[param] = false));
+/// @brief Immutable snapshot of parsed command line arguments
+///
+/// Created by CMD::CommandLineArgs::snapshot. Everything is resolved when the snapshot is created, reading
+/// values does not modify the snapshot and does not allocate. Thus a snapshot can be shared between any
+/// number of threads, via std::shared_ptr, without locking. Values are requested the same way as with
+/// CMD::CommandLineArgs::getValue.
+class ParsedArgs {
+public:
+	using Type = CommandLineArgs::Type;
+	using ParamId = CommandLineArgs::ParamId;
+
+	ParsedArgs(const ParsedArgs&) = delete;
+	ParsedArgs& operator=(const ParsedArgs&) = delete;
+
+	/// @brief Get the value of a parameter. See CMD::CommandLineArgs::getValue.
+	template<Type ParamT, typename OutT = CommandLineArgs::TypeMatch<ParamT>::type>
+	const OutT* getValue(std::string_view param) const {
+		return CommandLineArgs::readValue<ParamT, OutT>(*paramTable, paramValues, getParamId(param));
+	}
+
+	/// @brief Get the value of a parameter by id. See CMD::CommandLineArgs::getValue.
+	template<Type ParamT, typename OutT = CommandLineArgs::TypeMatch<ParamT>::type>
+	const OutT* getValue(ParamId id) const {
+		return CommandLineArgs::readValue<ParamT, OutT>(*paramTable, paramValues, id);
+	}
+
+	/// @brief Get the value of a parameter with user type. See CMD::CommandLineArgs::getValue<T>.
+	template<ParsableValue T>
+	const T* getValue(std::string_view param) const {
+		return CommandLineArgs::readCustom<T>(*paramTable, paramValues, getParamId(param));
+	}
+
+	/// @brief Get the value of a parameter with user type by id. See CMD::CommandLineArgs::getValue<T>.
+	template<ParsableValue T>
+	const T* getValue(ParamId id) const {
+		return CommandLineArgs::readCustom<T>(*paramTable, paramValues, id);
+	}
+
+	/// @brief Get the positional arguments. See CMD::CommandLineArgs::getPositionals.
+	std::span<const std::string_view> getPositionals() const {
+		return paramValues.positionals.view;
+	}
+
+	/// @brief Get where the value of a parameter came from. See CMD::CommandLineArgs::getSource.
+	CommandLineArgs::Source getSource(ParamId id) const {
+		return CommandLineArgs::getSourceOf(paramValues, id);
+	}
+
+	/// @brief Get the id of a parameter. See CMD::CommandLineArgs::getParamId.
+	ParamId getParamId(std::string_view param) const {
+		return CommandLineArgs::findParamId(*paramTable, param);
+	}
+
+	/// @brief Compare with a snapshot created by the same parser
+	/// @return Ids of the parameters which were passed in only one of the snapshots or have different
+	/// values, in increasing order. Parameters which exist in only one of the snapshots are included.
+	std::vector<ParamId> changedParams(const ParsedArgs& other) const {
+		return CommandLineArgs::changedParams(*paramTable, paramValues, *other.paramTable, other.paramValues);
+	}
+
+	/// @brief Write the snapshot in a binary blob. See CMD::CommandLineArgs::serialize.
+	std::vector<std::byte> serialize() const {
+		return CommandLineArgs::serialize(*paramTable, paramValues);
+	}
+private:
+	friend class CommandLineArgs;
+
+	/// @brief Takes the values, they are built once by the parse and never copied
+	ParsedArgs(std::shared_ptr<const CommandLineArgs::ParamTable> table, CommandLineArgs::ParamValues&& values) :
+		paramTable(std::move(table)),
+		paramValues(std::move(values))
+	{ }
+
+	std::shared_ptr<const CommandLineArgs::ParamTable> paramTable;
+	const CommandLineArgs::ParamValues paramValues;
+};
+
+/// @brief Parsed values which can be replaced while other threads read them
+///
+/// Holds the current CMD::ParsedArgs snapshot. reload parses into a new snapshot and publishes it by
+/// swapping a pointer, RCU style. Readers never block and never lock: read enters the current epoch with
+/// one atomic increment and returns the snapshot, leaving the epoch is one atomic decrement. The thread
+/// which publishes waits until all readers which could see the old snapshot have left before it is
+/// released. Thus a daemon can pick up changed settings without a restart:
+/// @code
+///		CMD::ReloadableArgs live(parser, parser.snapshot());
+///		// Hot path, any thread
+///		if (const auto args = live.read()) {
+///			const int* threads = args->getValue<CMD::CommandLineArgs::Type::Int>("threads");
+///		}
+///		// On SIGHUP
+///		live.reload(argc, argv, sources);
+/// @endcode
+class ReloadableArgs {
+	struct Slot {
+		std::shared_ptr<const ParsedArgs> args;
+	};
+public:
+	using ErrorCode = CommandLineArgs::ErrorCode;
+	using ParamId = CommandLineArgs::ParamId;
+
+	/// @brief Called by the thread which publishes a new snapshot, after readers of the old one have left
+	/// @param[in] previous The old snapshot
+	/// @param[in] current The new snapshot
+	/// @param[in] changed Ids of the parameters which changed, see CMD::ParsedArgs::changedParams
+	using ChangeCallbackT = std::function<void(
+		const ParsedArgs& previous,
+		const ParsedArgs& current,
+		std::span<const ParamId> changed
+	)>;
+
+	/// @brief Access to the current snapshot. The snapshot is not released while the reader exists, keep
+	/// readers short, a thread which publishes waits for them.
+	class Reader {
+	public:
+		Reader(Reader&& other) noexcept :
+			readers(std::exchange(other.readers, nullptr)),
+			slot(other.slot)
+		{ }
+		Reader(const Reader&) = delete;
+		Reader& operator=(const Reader&) = delete;
+		Reader& operator=(Reader&&) = delete;
+		~Reader() {
+			if (readers) {
+				readers->fetch_sub(1, std::memory_order_release);
 			}
 		}
+
+		/// @brief False if no snapshot was published
+		explicit operator bool() const {
+			return slot && slot->args;
+		}
+
+		const ParsedArgs* operator->() const {
+			return slot->args.get();
+		}
+
+		const ParsedArgs& operator*() const {
+			return *slot->args;
+		}
+	private:
+		friend class ReloadableArgs;
+
+		Reader(std::atomic<uint64_t>* readers, const Slot* slot) :
+			readers(readers),
+			slot(slot)
+		{ }
+
+		std::atomic<uint64_t>* readers;
+		const Slot* slot;
+	};
+
+	/// @param[in] parser Parser used by reload. It must outlive this object and must not be modified while
+	/// reload is running.
+	/// @param[in] initial The first snapshot, can be null
+	explicit ReloadableArgs(const CommandLineArgs& parser, std::shared_ptr<const ParsedArgs> initial = nullptr);
+	~ReloadableArgs();
+
+	ReloadableArgs(const ReloadableArgs&) = delete;
+	ReloadableArgs& operator=(const ReloadableArgs&) = delete;
+
+	/// @brief Get the current snapshot for a short read. Wait free.
+	Reader read() const;
+	/// @brief Get a reference to the current snapshot which can be kept for long
+	std::shared_ptr<const ParsedArgs> load() const;
+
+	/// @brief Parse into a new snapshot with the const CMD::CommandLineArgs::parse and publish it. On error
+	/// the current snapshot is kept.
+	/// @param[out] validationErrors Receives the values rejected by validators, see CMD::CommandLineArgs::parse. Can be null.
+	/// @return The code returned by parse
+	[[nodiscard]]
+	ErrorCode reload(
+		const int numArgs,
+		char** args,
+		const CommandLineArgs::Sources& sources,
+		CommandLineArgs::ErrorCallbackT errorCallback = nullptr,
+		std::vector<CommandLineArgs::ValidationError>* validationErrors = nullptr
+	);
+	/// @brief Replace the current snapshot. Returns after the old snapshot is no longer read and the change
+	/// callback is done. Publishing from multiple threads is serialized.
+	void publish(std::shared_ptr<const ParsedArgs> args);
+	/// @brief Set the callback called after each publish which changes at least one parameter, null to remove it
+	void setChangeCallback(ChangeCallbackT callback);
+private:
+	/// @brief Wait until all readers which entered before the last publish have left
+	void waitForReaders();
+
+	const CommandLineArgs& parser;
+	std::atomic<Slot*> current;
+	/// Incremented twice by each publish, its lowest bit selects the reader counter
+	std::atomic<uint64_t> epoch;
+	/// Readers which entered in even and in odd epochs
+	mutable std::atomic<uint64_t> readers[2];
+	/// Serializes publish and guards changeCallback
+	std::mutex publishMutex;
+	ChangeCallbackT changeCallback;
+};
+
+template<CommandLineArgs::Type ParamT, typename OutT>
+const OutT* CommandLineArgs::getValue(std::string_view param) const {
+	return getValue<ParamT, OutT>(getParamId(param));
+}
+
+template<CommandLineArgs::Type ParamT, typename OutT>
+const OutT* CommandLineArgs::getValue(ParamId id) const {
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+	recordAccess(id);
+#endif
+	return readValue<ParamT, OutT>(*paramTable, valueStore->values, id);
+}
+
+template<CommandLineArgs::Type ParamT, typename OutT>
+const OutT* CommandLineArgs::readValue(const ParamTable& table, const ParamValues& values, ParamId id) {
+	if (id >= table.types.size() || table.types[id] != ParamT) {
 		return nullptr;
 	}
-	
-	if (!std::holds_alternative<OutT>(it->second)) {
-		return nullptr;
+	const bool isPresent = values.present.test(id);
+	if constexpr (ParamT == Type::Flag) {
+		return &detail::flagValues[isPresent];
+	} else {
+		const auto& column = getColumn<OutT>(values);
+		const uint32_t index = table.columns[id];
+		if (!isPresent || index >= column.size()) {
+			return nullptr;
+		}
+		if constexpr (ParamT == Type::IntList || ParamT == Type::StringList) {
+			return &column[index].view;
+		} else {
+			return &column[index];
+		}
+	}
+}
+
+inline CommandLineArgs::ParamId CommandLineArgs::findParamId(const ParamTable& table, std::string_view param) {
+	const auto it = table.ids.find(param);
+	return it == table.ids.end() ? invalidParamId : it->second;
+}
+
+inline CommandLineArgs::ParamId CommandLineArgs::getParamId(std::string_view param) const {
+	const ParamId id = findParamId(*paramTable, param);
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+	if (id == invalidParamId) {
+		instrumentation->lookupMisses.fetch_add(1, std::memory_order_relaxed);
+		if (ParseObserver* observer = instrumentation->observer.load(std::memory_order_acquire)) {
+			observer->onLookupMiss(param);
+		}
+	}
+#endif
+	return id;
+}
+
+template<typename NameT, typename DescT>
+CommandLineArgs::ErrorCode CommandLineArgs::addParam(
+	CommandLineArgs::Type paramT,
+	NameT&& name,
+	DescT&& description,
+	bool required,
+	ParamId* id
+) {
+	// Custom parameters need their C++ type, they are added with addParam<T>
+	if (paramT == Type::Custom) {
+		return ErrorCode::WrongValueType;
+	}
+	return insertParam(paramT, std::forward<NameT>(name), std::forward<DescT>(description), required, nullptr, id);
+}
+
+template<ParsableValue T, typename NameT, typename DescT>
+CommandLineArgs::ErrorCode CommandLineArgs::addParam(NameT&& name, DescT&& description, bool required, ParamId* id) {
+	return insertParam(
+		Type::Custom,
+		std::forward<NameT>(name),
+		std::forward<DescT>(description),
+		required,
+		&detail::customTypeOf<T>,
+		id
+	);
+}
+
+template<ParsableValue T, typename NameT, typename DescT>
+CommandLineArgs::ErrorCode CommandLineArgs::addParam(
+	NameT&& name,
+	DescT&& description,
+	T* destination,
+	bool required,
+	ParamId* id
+) {
+	if (destination == nullptr) {
+		return ErrorCode::WrongValueType;
+	}
+	ParamId newId;
+	const ErrorCode code = addParam<T>(std::forward<NameT>(name), std::forward<DescT>(description), required, &newId);
+	if (code == ErrorCode::Success) {
+		bindings[newId] = destination;
+		if (id) {
+			*id = newId;
+		}
+	}
+	return code;
+}
+
+template<typename NameT, typename DescT>
+CommandLineArgs::ErrorCode CommandLineArgs::insertParam(
+	Type paramT,
+	NameT&& name,
+	DescT&& description,
+	bool required,
+	const detail::CustomType* customType,
+	ParamId* id
+) {
+	const std::string_view paramName(name);
+	if (findParamId(*paramTable, paramName) != invalidParamId) {
+		return ErrorCode::ParameterExists;
 	}
-	
-	return &std::get<OutT>(it->second);
+	ParamTable& table = mutableTable();
+	ParamValues& values = valueStore->values;
+	descriptionGenerated = false;
+	const ParamId newId = ParamId(table.names.size());
+	uint32_t column = 0;
+	switch (paramT) {
+		case Type::Int: column = table.intCount++; break;
+		case Type::Int64: column = table.int64Count++; break;
+		case Type::UInt64:
+		case Type::Size: column = table.uint64Count++; break;
+		case Type::Double: column = table.doubleCount++; break;
+		case Type::String: column = table.stringCount++; break;
+		case Type::IntList: column = table.intListCount++; break;
+		case Type::StringList: column = table.stringListCount++; break;
+		case Type::Custom: {
+			column = uint32_t(table.customTypes.size());
+			table.customTypes.push_back(customType);
+		} break;
+		case Type::Flag: break;
+	}
+	table.ids.try_emplace(std::pmr::string(paramName, resource), newId);
+	table.names.emplace_back(paramName);
+	table.descriptions.emplace_back(std::forward<DescT>(description));
+	table.types.push_back(paramT);
+	table.columns.push_back(column);
+	table.shortNames.push_back('\0');
+	table.required.resize(newId + 1);
+	if (required) {
+		table.required.set(newId);
+	}
+	values.resize(table, stringStorage);
+	bindings.resize(newId + 1);
+	validators.resize(newId + 1);
+#ifdef CMD_LINE_ARGS_INSTRUMENTATION
+	instrumentation->accessCounts.emplace_back(0);
+#endif
+	if (id) {
+		*id = newId;
+	}
+	return ErrorCode::Success;
 }
 
 template<typename NameT, typename DescT>
-CommandLineArgs::ErrorCode CommandLineArgs::addParam(CommandLineArgs::Type paramT, NameT&& name, DescT&& description, bool required) {
-	std::string paramName = std::forward<NameT>(name);
-	auto it = paramInfo.find(paramName);
-	if (it != paramInfo.end()) {
+CommandLineArgs::ErrorCode CommandLineArgs::addSubcommand(NameT&& name, DescT&& description, SubcommandFactoryT factory) {
+	const std::string_view subcommandName(name);
+	if (subcommands.ids.find(subcommandName) != subcommands.ids.end()) {
 		return ErrorCode::ParameterExists;
 	}
 	descriptionGenerated = false;
-	paramInfo[std::move(paramName)] = ParamInfo(std::forward<DescT>(description), paramT, required);
+	subcommands.ids.try_emplace(std::pmr::string(subcommandName, resource), uint32_t(subcommands.list.size()));
+	subcommands.list.push_back(Subcommand{
+		std::pmr::string(subcommandName, resource),
+		std::pmr::string(std::string_view(description), resource),
+		std::move(factory),
+		nullptr
+	});
 	return ErrorCode::Success;
 }
 
+template<typename NameT, typename DescT, typename ValueT>
+CommandLineArgs::ErrorCode CommandLineArgs::addParam(
+	Type paramT,
+	NameT&& name,
+	DescT&& description,
+	ValueT* destination,
+	bool required,
+	ParamId* id
+) {
+	if (destination == nullptr || !canBind<ValueT>(paramT)) {
+		return ErrorCode::WrongValueType;
+	}
+	ParamId newId;
+	const ErrorCode code = addParam(paramT, std::forward<NameT>(name), std::forward<DescT>(description), required, &newId);
+	if (code == ErrorCode::Success) {
+		bindings[newId] = destination;
+		if (id) {
+			*id = newId;
+		}
+	}
+	return code;
+}
+
+namespace detail {
+
+/// @brief Text in the blob written by CommandLineArgs::serialize
+struct BlobString {
+	/// Offset from the start of the blob
+	uint64_t offset;
+	uint64_t size;
+};
+
+/// @brief One parameter in the blob written by CommandLineArgs::serialize
+struct BlobParam {
+	BlobString name;
+	/// Offset of the value from the start of the blob. Scalars are stored in 8 bytes, String is the characters,
+	/// IntList is an array of int and StringList is an array of BlobString. 0 if the parameter was not passed
+	/// and for Custom, values of user types are not written.
+	uint64_t value;
+	/// Number of characters for String, number of items for lists, 0 otherwise
+	uint64_t size;
+	/// Index of the parameter among the parameters with the same type, as in CommandLineArgs
+	uint32_t column;
+	/// CommandLineArgs::Type
+	uint8_t type;
+	uint8_t present;
+	uint8_t required;
+	/// CommandLineArgs::Source
+	uint8_t source;
+};
+
+/// @brief Start of the blob written by CommandLineArgs::serialize. All offsets are from the start of the blob.
+struct BlobHeader {
+	static constexpr char expectedMagic[8] = {'C', 'M', 'D', 'A', 'R', 'G', 'S', '\0'};
+	static constexpr uint32_t currentVersion = 1;
+	/// Written in the byte order of the writer, so that a reader with other byte order rejects the blob
+	static constexpr uint32_t byteOrderMark = 0x01020304;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	/// Size of the whole blob
+	uint64_t size;
+	uint32_t paramCount;
+	uint32_t stringCount;
+	uint32_t intListCount;
+	uint32_t stringListCount;
+	/// Offset of BlobParam[paramCount], indexed by ParamId
+	uint64_t params;
+	/// Offset of uint32_t[paramCount], ids sorted by name
+	uint64_t sortedIds;
+	/// Offset of BlobString[positionalCount]
+	uint64_t positionals;
+	uint64_t positionalCount;
+};
+
+} // namespace detail
+
+/// @brief Parameters and values read in place from a blob written by CMD::CommandLineArgs::serialize
+///
+/// Nothing is parsed and values are not copied. open checks the blob and creates the views for string and
+/// list values, it is the only function which allocates. After that values are requested the same way as with
+/// CMD::CommandLineArgs::getValue, scalar values point into the blob. Strings are returned as std::string_view,
+/// the same as with StringStorage::View. The blob must outlive the object and must not change.
+/// @code
+///		// Parent
+///		const std::vector<std::byte> blob = parser.serialize();
+///		// Write the blob in a memfd or shared memory which the child maps
+///		// Child
+///		CMD::SerializedArgs args;
+///		if (args.open(mappedBlob) != CMD::CommandLineArgs::ErrorCode::Success) {
+///			return 1;
+///		}
+///		const int* threads = args.getValue<CMD::CommandLineArgs::Type::Int>("threads");
+/// @endcode
+class SerializedArgs {
+public:
+	using Type = CommandLineArgs::Type;
+	using ParamId = CommandLineArgs::ParamId;
+	using ErrorCode = CommandLineArgs::ErrorCode;
+
+	SerializedArgs() = default;
+	SerializedArgs(SerializedArgs&&) = default;
+	SerializedArgs& operator=(SerializedArgs&&) = default;
+	SerializedArgs(const SerializedArgs&) = delete;
+	SerializedArgs& operator=(const SerializedArgs&) = delete;
+
+	/// @brief Check the blob and make its values available
+	/// @param[in] blob The blob, aligned to 8 bytes
+	/// @return ErrorCode::InvalidSerializedData if the blob is not aligned, has other version, other byte
+	/// order or is not consistent. ErrorCode::Success otherwise.
+	[[nodiscard]]
+	ErrorCode open(std::span<const std::byte> blob);
+
+	/// @brief Get the value of a parameter. See CMD::CommandLineArgs::getValue.
+	template<Type ParamT, typename OutT = std::conditional_t<
+		ParamT == Type::String,
+		std::string_view,
+		typename CommandLineArgs::TypeMatch<ParamT>::type
+	>>
+	const OutT* getValue(std::string_view param) const {
+		return getValue<ParamT, OutT>(getParamId(param));
+	}
+
+	/// @brief Get the value of a parameter by id. See CMD::CommandLineArgs::getValue.
+	template<Type ParamT, typename OutT = std::conditional_t<
+		ParamT == Type::String,
+		std::string_view,
+		typename CommandLineArgs::TypeMatch<ParamT>::type
+	>>
+	const OutT* getValue(ParamId id) const;
+
+	/// @brief Get the id of a parameter, found by binary search over the sorted names in the blob
+	/// @return The id or CMD::CommandLineArgs::invalidParamId
+	ParamId getParamId(std::string_view param) const;
+
+	/// @brief Get where the value of a parameter came from. See CMD::CommandLineArgs::getSource.
+	CommandLineArgs::Source getSource(ParamId id) const {
+		return id < paramCount ? CommandLineArgs::Source(params[id].source) : CommandLineArgs::Source::Default;
+	}
+
+	/// @brief Get the positional arguments. See CMD::CommandLineArgs::getPositionals.
+	std::span<const std::string_view> getPositionals() const {
+		return positionals;
+	}
+private:
+	std::string_view text(const detail::BlobString& string) const {
+		return std::string_view(reinterpret_cast<const char*>(data + string.offset), string.size);
+	}
+
+	const std::byte* data = nullptr;
+	const detail::BlobParam* params = nullptr;
+	const uint32_t* sortedIds = nullptr;
+	uint32_t paramCount = 0;
+	/// Views created by open, indexed by the column of the parameter
+	std::vector<std::string_view> strings;
+	std::vector<std::span<const int>> intLists;
+	std::vector<std::span<const std::string_view>> stringLists;
+	/// Items of all string lists and the positional arguments
+	std::vector<std::string_view> listItems;
+	std::span<const std::string_view> positionals;
+};
+
+template<CommandLineArgs::Type ParamT, typename OutT>
+const OutT* SerializedArgs::getValue(ParamId id) const {
+	if (id >= paramCount || Type(params[id].type) != ParamT) {
+		return nullptr;
+	}
+	const detail::BlobParam& param = params[id];
+	if constexpr (ParamT == Type::Flag) {
+		return &detail::flagValues[param.present != 0];
+	} else {
+		if (!param.present) {
+			return nullptr;
+		}
+		if constexpr (ParamT == Type::String) {
+			if constexpr (std::is_same_v<OutT, std::string_view>) {
+				return &strings[param.column];
+			} else {
+				return nullptr;
+			}
+		} else if constexpr (ParamT == Type::IntList) {
+			return &intLists[param.column];
+		} else if constexpr (ParamT == Type::StringList) {
+			return &stringLists[param.column];
+		} else {
+			static_assert(std::is_same_v<OutT, typename CommandLineArgs::TypeMatch<ParamT>::type>, "Wrong type");
+			return reinterpret_cast<const OutT*>(data + param.value);
+		}
+	}
+}
+
 }
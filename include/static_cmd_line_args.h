@@ -0,0 +1,376 @@
+#pragma once
+#include "cmd_line_args.h"
+#include <array>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+/// @file
+/// Compile time parameter schema. All parameters are declared as template arguments, the names are
+/// put in a perfect hash table at compile time and values are accessed by name without any runtime
+/// lookup.
+///
+/// @code
+///		using Args = CMD::StaticCommandLineArgs<
+///			CMD::Param<"threads", CMD::CommandLineArgs::Type::Int>,
+///			CMD::Param<"verbose", CMD::CommandLineArgs::Type::Flag>,
+///			CMD::Param<"out", CMD::CommandLineArgs::Type::String, true, "Output file">
+///		>;
+///		Args args;
+///		if(args.parse(argc, argv) != CMD::CommandLineArgs::ErrorCode::Success) {
+///			return 1;
+///		}
+///		const int* threads = args.get<"threads">(); // Single array read, nullptr if not passed
+///		const bool* verbose = args.get<"verbose">(); // Flags are never null
+///		args.get<"thread">(); // Compile error, unknown parameter
+/// @endcode
+
+namespace CMD {
+
+/// @brief String literal which can be used as a non type template parameter
+template<std::size_t N>
+struct FixedString {
+	constexpr FixedString(const char (&str)[N]) {
+		std::copy_n(str, N, data);
+	}
+
+	constexpr std::string_view view() const {
+		return std::string_view(data, N - 1);
+	}
+
+	char data[N];
+};
+
+/// @brief Compile time declaration of a parameter for CMD::StaticCommandLineArgs
+/// @tparam Name The name of the parameter, must not include - or =
+/// @tparam ParamT The type of the parameter. One of CMD::CommandLineArgs::Type
+/// @tparam Required If true, parse will fail if the parameter is not passed
+/// @tparam Description Description of the parameter
+template<FixedString Name, CommandLineArgs::Type ParamT, bool Required = false, FixedString Description = "">
+struct Param {
+	static_assert(
+		ParamT == CommandLineArgs::Type::Int ||
+		ParamT == CommandLineArgs::Type::String ||
+		ParamT == CommandLineArgs::Type::Flag ||
+		ParamT == CommandLineArgs::Type::Int64 ||
+		ParamT == CommandLineArgs::Type::UInt64 ||
+		ParamT == CommandLineArgs::Type::Double ||
+		ParamT == CommandLineArgs::Type::Size,
+		"Unknown parameter type"
+	);
+	static_assert(Name.view().size() > 0, "Parameter name must not be empty");
+	static constexpr std::string_view name = Name.view();
+	static constexpr std::string_view description = Description.view();
+	static constexpr CommandLineArgs::Type type = ParamT;
+	static constexpr bool required = Required;
+};
+
+namespace detail {
+
+/// @brief Seeded hash of a parameter name. Used both at compile time to build the table and at
+/// runtime when looking up parsed names, thus both must produce the same result.
+constexpr uint32_t hashName(std::string_view name, uint32_t seed) {
+	uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+	for (const char c : name) {
+		h ^= static_cast<unsigned char>(c);
+		h *= 16777619u;
+	}
+	// FNV has weak low bits, mix them since the table is indexed by the low bits.
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35u;
+	h ^= h >> 16;
+	return h;
+}
+
+/// @brief Perfect hash table over a fixed set of names using the hash and displace scheme.
+/// Names are split into buckets using seed 0. Each bucket stores either a seed which sends all of its
+/// names to free slots, or if it holds only one name the negated slot where the name is.
+template<std::size_t N>
+struct PerfectHash {
+	static constexpr std::size_t size = N == 0 ? 1 : std::bit_ceil(N);
+	static constexpr uint16_t emptySlot = 0xFFFF;
+	static_assert(N < emptySlot, "Too many parameters");
+
+	/// @brief Find the index of a name in the array the table was built from
+	/// @param[in] name The name to search for
+	/// @param[in] names The array of names the table was built from
+	/// @return The index of the name or -1 if it is not in the table
+	constexpr int find(std::string_view name, const std::string_view* names) const {
+		const int32_t d = displacement[hashName(name, 0) & (size - 1)];
+		const uint32_t slot = d < 0 ? uint32_t(-d - 1) : hashName(name, d) & (size - 1);
+		const uint16_t index = slots[slot];
+		return index != emptySlot && names[index] == name ? index : -1;
+	}
+
+	std::array<int32_t, size> displacement{};
+	std::array<uint16_t, size> slots{};
+};
+
+template<std::size_t N>
+constexpr bool hasDuplicates(const std::array<std::string_view, N>& names) {
+	for (std::size_t i = 0; i < N; ++i) {
+		for (std::size_t j = i + 1; j < N; ++j) {
+			if (names[i] == names[j]) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+template<std::size_t N>
+constexpr PerfectHash<N> buildPerfectHash(const std::array<std::string_view, N>& names) {
+	using Table = PerfectHash<N>;
+	constexpr std::size_t mask = Table::size - 1;
+	Table table;
+	table.slots.fill(Table::emptySlot);
+
+	std::array<std::size_t, Table::size> bucketSize{};
+	std::array<std::size_t, N> bucketOf{};
+	for (std::size_t i = 0; i < N; ++i) {
+		bucketOf[i] = hashName(names[i], 0) & mask;
+		bucketSize[bucketOf[i]]++;
+	}
+
+	// Place the biggest buckets first, while there are many free slots
+	std::array<std::size_t, Table::size> order{};
+	for (std::size_t i = 0; i < Table::size; ++i) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+		return bucketSize[a] > bucketSize[b];
+	});
+
+	std::size_t nextFree = 0;
+	for (const std::size_t bucket : order) {
+		if (bucketSize[bucket] == 0) {
+			break;
+		}
+		if (bucketSize[bucket] == 1) {
+			while (table.slots[nextFree] != Table::emptySlot) {
+				nextFree++;
+			}
+			for (std::size_t i = 0; i < N; ++i) {
+				if (bucketOf[i] == bucket) {
+					table.slots[nextFree] = uint16_t(i);
+				}
+			}
+			table.displacement[bucket] = -int32_t(nextFree) - 1;
+			continue;
+		}
+		for (int32_t seed = 1;; ++seed) {
+			// Running out of seeds is a constexpr evaluation failure, i.e. a compile error
+			if (seed == (1 << 24)) {
+				throw "Cannot build perfect hash for parameter names";
+			}
+			std::array<bool, Table::size> taken{};
+			bool fits = true;
+			for (std::size_t i = 0; i < N && fits; ++i) {
+				if (bucketOf[i] == bucket) {
+					const uint32_t slot = hashName(names[i], seed) & mask;
+					fits = table.slots[slot] == Table::emptySlot && !taken[slot];
+					taken[slot] = true;
+				}
+			}
+			if (fits) {
+				for (std::size_t i = 0; i < N; ++i) {
+					if (bucketOf[i] == bucket) {
+						table.slots[hashName(names[i], seed) & mask] = uint16_t(i);
+					}
+				}
+				table.displacement[bucket] = seed;
+				break;
+			}
+		}
+	}
+	return table;
+}
+
+/// @brief Non template view over the schema of StaticCommandLineArgs used by the parser
+struct StaticSchemaRef {
+	const std::string_view* names;
+	const CommandLineArgs::Type* types;
+	const bool* required;
+	/// Index of the value of each parameter in the column for its type
+	const uint16_t* columns;
+	std::size_t count;
+	int(*find)(std::string_view name);
+};
+
+/// @brief Non template view over the values of StaticCommandLineArgs used by the parser
+struct StaticValuesRef {
+	template<typename T>
+	T* column() const {
+		if constexpr (std::is_same_v<T, int>) {
+			return ints;
+		} else if constexpr (std::is_same_v<T, int64_t>) {
+			return int64s;
+		} else if constexpr (std::is_same_v<T, uint64_t>) {
+			return uint64s;
+		} else if constexpr (std::is_same_v<T, double>) {
+			return doubles;
+		} else {
+			static_assert(sizeof(T) < 0, "Unknown type");
+		}
+	}
+
+	int* ints;
+	int64_t* int64s;
+	/// UInt64 and Size parameters
+	uint64_t* uint64s;
+	double* doubles;
+	std::string* strings;
+	/// Bitset with one bit per parameter. Bit is set if the parameter was passed.
+	uint64_t* present;
+};
+
+/// @brief Parse argv against a compile time schema. Does the same checks and reports the same errors
+/// as CMD::CommandLineArgs::parse.
+[[nodiscard]]
+CommandLineArgs::ErrorCode parseStatic(
+	const StaticSchemaRef& schema,
+	const StaticValuesRef& values,
+	const int numArgs,
+	char** args,
+	CommandLineArgs::ErrorCallbackT errorCallback
+);
+
+} // namespace detail
+
+/// @brief Command line arguments parser with a schema fixed at compile time
+///
+/// Works the same way as CMD::CommandLineArgs, but parameters are declared via CMD::Param template
+/// arguments instead of calling addParam. Declaring the same name twice is a compile error, so is
+/// requesting a name which was not declared. Names are looked up during parse via perfect hash and
+/// CMD::StaticCommandLineArgs::get is a single array read.
+/// @tparam Params List of CMD::Param
+template<typename... Params>
+class StaticCommandLineArgs {
+	using Type = CommandLineArgs::Type;
+	using ErrorCode = CommandLineArgs::ErrorCode;
+
+	static constexpr std::size_t paramCount = sizeof...(Params);
+	static constexpr std::array<std::string_view, paramCount> names = {Params::name...};
+	static constexpr std::array<std::string_view, paramCount> descriptions = {Params::description...};
+	static constexpr std::array<Type, paramCount> types = {Params::type...};
+	static constexpr std::array<bool, paramCount> required = {Params::required...};
+
+	static_assert(!detail::hasDuplicates(names), "Parameter declared more than once");
+
+	/// @brief Types which share one column, UInt64 and Size are both stored as uint64_t
+	static constexpr Type columnType(Type t) {
+		return t == Type::Size ? Type::UInt64 : t;
+	}
+
+	static constexpr std::size_t countOf(Type t) {
+		return std::size_t(std::count_if(types.begin(), types.end(), [t](Type other) {
+			return columnType(other) == t;
+		}));
+	}
+
+	static constexpr std::array<uint16_t, paramCount> buildColumns() {
+		std::array<uint16_t, paramCount> columns{};
+		for (std::size_t i = 0; i < paramCount; ++i) {
+			columns[i] = 0;
+			for (std::size_t j = 0; j < i; ++j) {
+				columns[i] += columnType(types[j]) == columnType(types[i]);
+			}
+		}
+		return columns;
+	}
+
+	static constexpr int indexOf(std::string_view name) {
+		for (std::size_t i = 0; i < paramCount; ++i) {
+			if (names[i] == name) {
+				return int(i);
+			}
+		}
+		return -1;
+	}
+
+	static constexpr std::array<uint16_t, paramCount> columns = buildColumns();
+	static constexpr detail::PerfectHash<paramCount> hashTable = detail::buildPerfectHash(names);
+
+	static int find(std::string_view name) {
+		return hashTable.find(name, names.data());
+	}
+public:
+	/// @brief Parse command line arguments that are parameters passed to main function.
+	/// @param[in] numArgs The number of the arguments
+	/// @param[in] args An array of arguments that comes from main function
+	/// @param[in] errorCallback A function which will be called if an error in the parsing happens
+	/// @returns The code of the first error encountered during the parsing or ErrorCode::Success in case of no errors
+	[[nodiscard]]
+	ErrorCode parse(const int numArgs, char** args, CommandLineArgs::ErrorCallbackT errorCallback = nullptr) {
+		const detail::StaticSchemaRef schema{
+			names.data(),
+			types.data(),
+			required.data(),
+			columns.data(),
+			paramCount,
+			&find
+		};
+		const detail::StaticValuesRef values{
+			ints.data(),
+			int64s.data(),
+			uint64s.data(),
+			doubles.data(),
+			strings.data(),
+			present.data()
+		};
+		return detail::parseStatic(schema, values, numArgs, args, errorCallback);
+	}
+
+	/// @brief Get the value of a parameter. Unknown names do not compile.
+	/// @tparam Name The name of the parameter
+	/// @return Pointer to the value of the parameter or nullptr if it was not passed. Flags always
+	/// return valid pointer to true if the flag was passed and to false otherwise.
+	template<FixedString Name>
+	const auto* get() const {
+		constexpr int index = indexOf(Name.view());
+		static_assert(index != -1, "Unknown parameter");
+		constexpr Type paramT = types[index];
+		const bool isPresent = present[index / 64] & (uint64_t(1) << (index % 64));
+		if constexpr (paramT == Type::Flag) {
+			return &detail::flagValues[isPresent];
+		} else if constexpr (paramT == Type::Int) {
+			return isPresent ? &ints[columns[index]] : nullptr;
+		} else if constexpr (paramT == Type::Int64) {
+			return isPresent ? &int64s[columns[index]] : nullptr;
+		} else if constexpr (paramT == Type::UInt64 || paramT == Type::Size) {
+			return isPresent ? &uint64s[columns[index]] : nullptr;
+		} else if constexpr (paramT == Type::Double) {
+			return isPresent ? &doubles[columns[index]] : nullptr;
+		} else {
+			return isPresent ? &strings[columns[index]] : nullptr;
+		}
+	}
+
+	/// @brief Get the description of a parameter. Unknown names do not compile.
+	template<FixedString Name>
+	static constexpr std::string_view getDescription() {
+		constexpr int index = indexOf(Name.view());
+		static_assert(index != -1, "Unknown parameter");
+		return descriptions[index];
+	}
+
+	/// @brief Delete only the parameters, the schema is fixed
+	void freeValues() {
+		present.fill(0);
+		strings.fill(std::string());
+	}
+private:
+	// Size is at least one, so that data() is never null.
+	std::array<int, std::max<std::size_t>(countOf(Type::Int), 1)> ints{};
+	std::array<int64_t, std::max<std::size_t>(countOf(Type::Int64), 1)> int64s{};
+	std::array<uint64_t, std::max<std::size_t>(countOf(Type::UInt64), 1)> uint64s{};
+	std::array<double, std::max<std::size_t>(countOf(Type::Double), 1)> doubles{};
+	std::array<std::string, std::max<std::size_t>(countOf(Type::String), 1)> strings;
+	std::array<uint64_t, paramCount / 64 + 1> present{};
+};
+
+}
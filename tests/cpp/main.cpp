@@ -1,6 +1,23 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 #include "cmd_line_args.h"
+#include "static_cmd_line_args.h"
+#include <thread>
+#include <atomic>
+#include <memory_resource>
+#include <limits>
+#include <vector>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <charconv>
+#include <chrono>
 
 TEST_SUITE("Parse Input") {
 	TEST_CASE("Empty") {
@@ -65,6 +82,8 @@ TEST_SUITE("Parse Input") {
 				CHECK_EQ(code, CMD::CommandLineArgs::ErrorCode::MissingValue);
 				CHECK_EQ(strcmp(param, "intParam"), 0);
 				CHECK_EQ(strcmp(input, "--intParam"), 0);
+				CHECK_NE(strstr(description, "--name value"), nullptr);
+				CHECK_NE(strstr(description, "). Received input is: --intParam"), nullptr);
 			};
 			REQUIRE_EQ(parser.parse(argc, argv, callback), CMD::CommandLineArgs::ErrorCode::MissingValue);
 			REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::Int>("intParam"), nullptr);
@@ -90,6 +109,82 @@ TEST_SUITE("Parse Input") {
 		}
 	}
 
+	TEST_CASE("Int param range and bases") {
+		CMD::CommandLineArgs parser;
+		parser.addParam(CMD::CommandLineArgs::Type::Int, "intParam", "An integer", false);
+		SUBCASE("Hex and octal") {
+			char* argv[2] = {"program", "--intParam=0x1F"};
+			REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>("intParam"), 31);
+			char* octal[2] = {"program", "--intParam=-017"};
+			REQUIRE_EQ(parser.parse(2, octal), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>("intParam"), -15);
+		}
+
+		SUBCASE("Limits") {
+			char* argv[2] = {"program", "--intParam=-2147483648"};
+			REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>("intParam"), std::numeric_limits<int>::min());
+		}
+
+		SUBCASE("Value which does not fit in int is an error") {
+			char* argv[2] = {"program", "--intParam=2147483648"};
+			REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+			REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::Int>("intParam"), nullptr);
+		}
+
+		SUBCASE("Sign without number is an error") {
+			char* argv[2] = {"program", "--intParam=-"};
+			REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+		}
+	}
+
+	TEST_CASE("Numeric params") {
+		CMD::CommandLineArgs parser;
+		parser.addParam(CMD::CommandLineArgs::Type::Int64, "offset", "64 bit integer", false);
+		parser.addParam(CMD::CommandLineArgs::Type::UInt64, "count", "64 bit unsigned integer", false);
+		parser.addParam(CMD::CommandLineArgs::Type::Double, "ratio", "Floating point", false);
+		parser.addParam(CMD::CommandLineArgs::Type::Size, "buffer", "Size in bytes", false);
+		SUBCASE("All are set") {
+			char* argv[5] = {"program", "--offset=-9000000000", "--count=18446744073709551615", "--ratio=2.5e-3", "--buffer=2G"};
+			REQUIRE_EQ(parser.parse(5, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int64>("offset"), -9000000000LL);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::UInt64>("count"), std::numeric_limits<uint64_t>::max());
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Double>("ratio"), 2.5e-3);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Size>("buffer"), uint64_t(2) << 30);
+			REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::UInt64>("buffer"), nullptr);
+		}
+
+		SUBCASE("Size suffixes") {
+			char* argv[2] = {"program", "--buffer=64k"};
+			REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Size>("buffer"), 64 * 1024);
+			char* plain[2] = {"program", "--buffer=100"};
+			REQUIRE_EQ(parser.parse(2, plain), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Size>("buffer"), 100);
+		}
+
+		SUBCASE("Overflow is an error") {
+			char* int64[2] = {"program", "--offset=9223372036854775808"};
+			REQUIRE_EQ(parser.parse(2, int64), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+			char* uint64[2] = {"program", "--count=18446744073709551616"};
+			REQUIRE_EQ(parser.parse(2, uint64), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+			char* size[2] = {"program", "--buffer=16384P"};
+			REQUIRE_EQ(parser.parse(2, size), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+			char* ratio[2] = {"program", "--ratio=1e400"};
+			REQUIRE_EQ(parser.parse(2, ratio), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+		}
+
+		SUBCASE("Wrong values") {
+			char* negative[2] = {"program", "--count=-1"};
+			REQUIRE_EQ(parser.parse(2, negative), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+			char* suffix[2] = {"program", "--buffer=12X"};
+			REQUIRE_EQ(parser.parse(2, suffix), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+			char* ratio[2] = {"program", "--ratio=1.5.2"};
+			REQUIRE_EQ(parser.parse(2, ratio), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+		}
+	}
+
 	TEST_CASE("String param") {
 		const int argc = 2;
 		CMD::CommandLineArgs parser;
@@ -116,4 +211,1582 @@ TEST_SUITE("Parse Input") {
 			REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::Int>("stringParam"), nullptr);
 		}
 	}
+
+	TEST_CASE("List params") {
+		CMD::CommandLineArgs parser;
+		parser.addParam(CMD::CommandLineArgs::Type::IntList, "shards", "Shard ids", false);
+		parser.addParam(CMD::CommandLineArgs::Type::StringList, "inputs", "Input files", false);
+		SUBCASE("Items are split on comma") {
+			char* argv[3] = {"program", "--shards=3,-1,0x10", "--inputs=a.txt,some/long/path/b.txt"};
+			REQUIRE_EQ(parser.parse(3, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			const std::span<const int> shards = *parser.getValue<CMD::CommandLineArgs::Type::IntList>("shards");
+			REQUIRE_EQ(shards.size(), 3);
+			REQUIRE_EQ(shards[0], 3);
+			REQUIRE_EQ(shards[1], -1);
+			REQUIRE_EQ(shards[2], 16);
+			const std::span<const std::string_view> inputs = *parser.getValue<CMD::CommandLineArgs::Type::StringList>("inputs");
+			REQUIRE_EQ(inputs.size(), 2);
+			REQUIRE_EQ(inputs[0], "a.txt");
+			REQUIRE_EQ(inputs[1], "some/long/path/b.txt");
+		}
+
+		SUBCASE("Repeated params are appended") {
+			char* argv[5] = {"program", "--shards=1", "--inputs=a", "--shards=2,3", "--inputs=a_much_longer_name_which_does_not_fit_in_place,c"};
+			REQUIRE_EQ(parser.parse(5, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			const std::span<const int> shards = *parser.getValue<CMD::CommandLineArgs::Type::IntList>("shards");
+			REQUIRE_EQ(shards.size(), 3);
+			REQUIRE_EQ(shards[2], 3);
+			const std::span<const std::string_view> inputs = *parser.getValue<CMD::CommandLineArgs::Type::StringList>("inputs");
+			REQUIRE_EQ(inputs.size(), 3);
+			REQUIRE_EQ(inputs[0], "a");
+			REQUIRE_EQ(inputs[1], "a_much_longer_name_which_does_not_fit_in_place");
+			REQUIRE_EQ(inputs[2], "c");
+		}
+
+		SUBCASE("Wrong item keeps the previous items") {
+			char* argv[3] = {"program", "--shards=1,2", "--shards=3,x"};
+			REQUIRE_EQ(parser.parse(3, argv), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+			REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::IntList>("shards")->size(), 2);
+			char* empty[2] = {"program", "--inputs=a,,b"};
+			REQUIRE_EQ(parser.parse(2, empty), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+			REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::StringList>("inputs"), nullptr);
+			char* missing[2] = {"program", "--inputs="};
+			REQUIRE_EQ(parser.parse(2, missing), CMD::CommandLineArgs::ErrorCode::MissingValue);
+		}
+
+		SUBCASE("Snapshot owns its copy of the list") {
+			char* argv[2] = {"program", "--inputs=first,second"};
+			REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			const std::shared_ptr<const CMD::ParsedArgs> snapshot = parser.snapshot();
+			parser.freeValues();
+			const std::span<const std::string_view> inputs = *snapshot->getValue<CMD::CommandLineArgs::Type::StringList>("inputs");
+			REQUIRE_EQ(inputs.size(), 2);
+			REQUIRE_EQ(inputs[1], "second");
+			REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::StringList>("inputs"), nullptr);
+		}
+	}
+}
+
+TEST_SUITE("Parameter Ids") {
+	TEST_CASE("Values can be requested by id") {
+		CMD::CommandLineArgs parser;
+		CMD::CommandLineArgs::ParamId intId, flagId, stringId;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "int", "An integer", false, &intId), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "flag", "A flag", false, &flagId), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::String, "str", "A string", false, &stringId), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(intId, 0);
+		REQUIRE_EQ(flagId, 1);
+		REQUIRE_EQ(stringId, 2);
+		REQUIRE_EQ(parser.getParamId("str"), stringId);
+		REQUIRE_EQ(parser.getParamId("missing"), CMD::CommandLineArgs::invalidParamId);
+
+		char* argv[3] = {"program", "--int=-12", "--str=abc"};
+		REQUIRE_EQ(parser.parse(3, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>(intId), -12);
+		REQUIRE_FALSE(*parser.getValue<CMD::CommandLineArgs::Type::Flag>(flagId));
+		REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::String>(stringId), "abc");
+		REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::String>(intId), nullptr);
+		REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::Int>(CMD::CommandLineArgs::ParamId(3)), nullptr);
+		REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::Int>(CMD::CommandLineArgs::invalidParamId), nullptr);
+	}
+
+	TEST_CASE("Parameter cannot be added twice") {
+		CMD::CommandLineArgs parser;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "int", "An integer", false), CMD::CommandLineArgs::ErrorCode::Success);
+		CMD::CommandLineArgs::ParamId id = CMD::CommandLineArgs::invalidParamId;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "int", "A flag", false, &id), CMD::CommandLineArgs::ErrorCode::ParameterExists);
+		REQUIRE_EQ(id, CMD::CommandLineArgs::invalidParamId);
+	}
+
+	TEST_CASE("Missing required parameter after many optional ones") {
+		CMD::CommandLineArgs parser;
+		for (int i = 0; i < 100; ++i) {
+			const std::string name = "param" + std::to_string(i);
+			REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, name, "", i == 70 || i == 90), CMD::CommandLineArgs::ErrorCode::Success);
+		}
+		char* argv[2] = {"program", "--param70"};
+		auto callback = [](CMD::CommandLineArgs::ErrorCode code, const char* param, const char* input, const char* description) -> void {
+			CHECK_EQ(code, CMD::CommandLineArgs::ErrorCode::MissingParameter);
+			CHECK_EQ(strcmp(param, "param90"), 0);
+		};
+		REQUIRE_EQ(parser.parse(2, argv, callback), CMD::CommandLineArgs::ErrorCode::MissingParameter);
+		REQUIRE(*parser.getValue<CMD::CommandLineArgs::Type::Flag>("param70"));
+	}
+
+	TEST_CASE("Free values keeps the parameters") {
+		CMD::CommandLineArgs parser;
+		parser.addParam(CMD::CommandLineArgs::Type::Int, "int", "An integer", true);
+		char* argv[2] = {"program", "--int=3"};
+		REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		parser.freeValues();
+		REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::Int>("int"), nullptr);
+		REQUIRE_EQ(parser.parse(1, argv), CMD::CommandLineArgs::ErrorCode::MissingParameter);
+		parser.freeMem();
+		REQUIRE_EQ(parser.getParamId("int"), CMD::CommandLineArgs::invalidParamId);
+	}
+}
+
+TEST_SUITE("Bound Variables") {
+	struct Config {
+		int threads = 4;
+		uint64_t cache = 0;
+		bool verbose = false;
+		std::string out = "a.out";
+		std::vector<int> shards = {0};
+	};
+
+	TEST_CASE("Parse writes into the variables") {
+		Config config;
+		CMD::CommandLineArgs parser;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "threads", "Threads", &config.threads, false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Size, "cache", "Cache size", &config.cache, false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "verbose", "Verbose", &config.verbose, false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::String, "out", "Output", &config.out, false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::IntList, "shards", "Shards", &config.shards, false), CMD::CommandLineArgs::ErrorCode::Success);
+		SUBCASE("Passed params") {
+			char* argv[7] = {"program", "--threads=16", "--cache=1M", "--verbose", "--out=result.txt", "--shards=1,2", "--shards=3"};
+			REQUIRE_EQ(parser.parse(7, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(config.threads, 16);
+			REQUIRE_EQ(config.cache, 1024 * 1024);
+			REQUIRE(config.verbose);
+			REQUIRE_EQ(config.out, "result.txt");
+			const std::vector<int> shards = {1, 2, 3};
+			REQUIRE_EQ(config.shards, shards);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>("threads"), 16);
+		}
+
+		SUBCASE("Params which are not passed keep their value") {
+			char* argv[2] = {"program", "--threads=2"};
+			REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(config.threads, 2);
+			REQUIRE_FALSE(config.verbose);
+			REQUIRE_EQ(config.out, "a.out");
+			REQUIRE_EQ(config.shards.size(), 1);
+		}
+
+		SUBCASE("Const parse does not write into the variables") {
+			char* argv[2] = {"program", "--threads=2"};
+			std::shared_ptr<const CMD::ParsedArgs> args;
+			REQUIRE_EQ(std::as_const(parser).parse(2, argv, args), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(config.threads, 4);
+			REQUIRE_EQ(*args->getValue<CMD::CommandLineArgs::Type::Int>("threads"), 2);
+		}
+	}
+
+	TEST_CASE("Variable type must match the parameter type") {
+		CMD::CommandLineArgs parser;
+		int64_t value;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "value", "Value", &value, false), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+		REQUIRE_EQ(parser.getParamId("value"), CMD::CommandLineArgs::invalidParamId);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int64, "value", "Value", &value, false), CMD::CommandLineArgs::ErrorCode::Success);
+	}
+}
+
+TEST_SUITE("Snapshot") {
+	TEST_CASE("Snapshot is not affected by the parser") {
+		CMD::CommandLineArgs parser;
+		parser.addParam(CMD::CommandLineArgs::Type::Int, "int", "An integer", false);
+		parser.addParam(CMD::CommandLineArgs::Type::Flag, "flag", "A flag", false);
+		parser.addParam(CMD::CommandLineArgs::Type::String, "str", "A string", false);
+		char* argv[3] = {"program", "--int=5", "--str=abc"};
+		REQUIRE_EQ(parser.parse(3, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		std::shared_ptr<const CMD::ParsedArgs> snapshot = parser.snapshot();
+
+		parser.freeValues();
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "other", "Added after the snapshot", false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::Int>("int"), nullptr);
+
+		REQUIRE_EQ(*snapshot->getValue<CMD::CommandLineArgs::Type::Int>("int"), 5);
+		REQUIRE_EQ(*snapshot->getValue<CMD::CommandLineArgs::Type::String>("str"), "abc");
+		REQUIRE_FALSE(*snapshot->getValue<CMD::CommandLineArgs::Type::Flag>("flag"));
+		REQUIRE_EQ(snapshot->getParamId("other"), CMD::CommandLineArgs::invalidParamId);
+		REQUIRE_EQ(snapshot->getValue<CMD::CommandLineArgs::Type::Flag>("int"), nullptr);
+	}
+
+	TEST_CASE("Snapshot can be read from many threads") {
+		CMD::CommandLineArgs parser;
+		parser.addParam(CMD::CommandLineArgs::Type::Int, "int", "An integer", false);
+		parser.addParam(CMD::CommandLineArgs::Type::Flag, "flag", "A flag", false);
+		char* argv[2] = {"program", "--int=42"};
+		REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		std::shared_ptr<const CMD::ParsedArgs> snapshot = parser.snapshot();
+
+		std::vector<std::thread> threads;
+		std::vector<int> sums(4, 0);
+		for (int i = 0; i < 4; ++i) {
+			threads.emplace_back([snapshot, &sums, i]() {
+				for (int j = 0; j < 1000; ++j) {
+					sums[i] += *snapshot->getValue<CMD::CommandLineArgs::Type::Int>("int");
+					sums[i] += *snapshot->getValue<CMD::CommandLineArgs::Type::Flag>("flag");
+				}
+			});
+		}
+		for (std::thread& t : threads) {
+			t.join();
+		}
+		for (const int sum : sums) {
+			REQUIRE_EQ(sum, 42000);
+		}
+	}
+}
+
+TEST_SUITE("Batch Parse") {
+	TEST_CASE("Const parse produces snapshot") {
+		CMD::CommandLineArgs parser;
+		parser.addParam(CMD::CommandLineArgs::Type::Int, "int", "An integer", true);
+		std::shared_ptr<const CMD::ParsedArgs> result;
+		char* argv[2] = {"program", "--int=7"};
+		REQUIRE_EQ(parser.parse(2, argv, result), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(*result->getValue<CMD::CommandLineArgs::Type::Int>("int"), 7);
+		REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::Int>("int"), nullptr);
+
+		REQUIRE_EQ(parser.parse(1, argv, result), CMD::CommandLineArgs::ErrorCode::MissingParameter);
+		REQUIRE_EQ(result, nullptr);
+	}
+
+	TEST_CASE("Many argument vectors") {
+		CMD::CommandLineArgs parser;
+		parser.addParam(CMD::CommandLineArgs::Type::Int, "task", "Task index", true);
+		parser.addParam(CMD::CommandLineArgs::Type::String, "name", "Task name", false);
+
+		const int taskCount = 1000;
+		std::vector<std::string> taskArgs;
+		std::vector<std::string> nameArgs;
+		for (int i = 0; i < taskCount; ++i) {
+			// Every 10th task has wrong integer
+			taskArgs.push_back(i % 10 == 3 ? "--task=x" : "--task=" + std::to_string(i));
+			nameArgs.push_back("--name=task" + std::to_string(i));
+		}
+		std::vector<std::vector<char*>> argvs(taskCount);
+		std::vector<CMD::CommandLineArgs::Arguments> inputs;
+		char program[] = "program";
+		for (int i = 0; i < taskCount; ++i) {
+			argvs[i] = {program, taskArgs[i].data(), nameArgs[i].data()};
+			inputs.push_back({3, argvs[i].data()});
+		}
+
+		for (const unsigned threads : {1u, 4u, 0u}) {
+			const std::vector<CMD::CommandLineArgs::BatchResult> results = parser.parseBatch(inputs, threads);
+			REQUIRE_EQ(results.size(), taskCount);
+			for (int i = 0; i < taskCount; ++i) {
+				if (i % 10 == 3) {
+					REQUIRE_EQ(results[i].code, CMD::CommandLineArgs::ErrorCode::WrongValueType);
+					REQUIRE_EQ(results[i].args, nullptr);
+				} else {
+					REQUIRE_EQ(results[i].code, CMD::CommandLineArgs::ErrorCode::Success);
+					REQUIRE_EQ(*results[i].args->getValue<CMD::CommandLineArgs::Type::Int>("task"), i);
+					REQUIRE_EQ(*results[i].args->getValue<CMD::CommandLineArgs::Type::String>("name"), "task" + std::to_string(i));
+				}
+			}
+		}
+	}
+
+	TEST_CASE("Empty batch") {
+		CMD::CommandLineArgs parser;
+		REQUIRE(parser.parseBatch({}).empty());
+	}
+}
+
+TEST_SUITE("Memory Resource") {
+	/// Counts allocations which reach the upstream resource
+	class CountingResource : public std::pmr::memory_resource {
+	public:
+		int allocations = 0;
+		/// Allocations of at least largeSize bytes
+		int largeAllocations = 0;
+		std::size_t largeSize = std::numeric_limits<std::size_t>::max();
+	private:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+			allocations++;
+			largeAllocations += bytes >= largeSize;
+			return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+			std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+	};
+
+	TEST_CASE("Arena reuses its blocks after reset") {
+		CountingResource upstream;
+		CMD::ArenaResource arena(&upstream, 64);
+		void* first = arena.allocate(16, 8);
+		for (int i = 0; i < 100; ++i) {
+			arena.allocate(24, 8);
+		}
+		const int allocations = upstream.allocations;
+		const std::size_t capacity = arena.capacity();
+		REQUIRE_GT(allocations, 1);
+
+		arena.reset();
+		REQUIRE_EQ(arena.allocate(16, 8), first);
+		for (int i = 0; i < 100; ++i) {
+			void* p = arena.allocate(24, 8);
+			REQUIRE_EQ(reinterpret_cast<std::uintptr_t>(p) % 8, 0);
+		}
+		REQUIRE_EQ(upstream.allocations, allocations);
+		REQUIRE_EQ(arena.capacity(), capacity);
+	}
+
+	TEST_CASE("Repeated parse does not allocate from the resource") {
+		CountingResource resource;
+		CMD::CommandLineArgs parser(&resource, CMD::CommandLineArgs::StringStorage::View);
+		parser.addParam(CMD::CommandLineArgs::Type::Int, "int", "An integer", true);
+		parser.addParam(CMD::CommandLineArgs::Type::String, "str", "A string", false);
+		parser.addParam(CMD::CommandLineArgs::Type::Flag, "flag", "A flag", false);
+		REQUIRE_GT(resource.allocations, 0);
+
+		char* argv[4] = {"program", "--int=1", "--str=some/long/path/which/does/not/fit/small/string", "--flag"};
+		REQUIRE_EQ(parser.parse(4, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		parser.freeValues();
+		const int allocations = resource.allocations;
+		for (int i = 0; i < 10; ++i) {
+			REQUIRE_EQ(parser.parse(4, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>("int"), 1);
+			parser.freeValues();
+			REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::Int>("int"), nullptr);
+		}
+		REQUIRE_EQ(resource.allocations, allocations);
+	}
+
+	TEST_CASE("Const parse builds the values once") {
+		CMD::CommandLineArgs parser;
+		parser.addParam(CMD::CommandLineArgs::Type::IntList, "ints", "Integers", true);
+		const int count = 100000;
+		std::string list = "--ints=1";
+		for (int i = 1; i < count; ++i) {
+			list.append(",1");
+		}
+		char* argv[2] = {"program", list.data()};
+		// Values of a snapshot come from the default resource. Only the list reaches its full size, once
+		// while it is parsed. Copying the values on the way to the snapshot would allocate it again.
+		CountingResource resource;
+		resource.largeSize = count * sizeof(int);
+		std::pmr::memory_resource* const previous = std::pmr::set_default_resource(&resource);
+		std::shared_ptr<const CMD::ParsedArgs> args;
+		const CMD::CommandLineArgs::ErrorCode code = parser.parse(2, argv, args);
+		const int largeAllocations = resource.largeAllocations;
+		std::size_t size = 0;
+		if (args) {
+			size = args->getValue<CMD::CommandLineArgs::Type::IntList>("ints")->size();
+		}
+		args.reset();
+		std::pmr::set_default_resource(previous);
+		REQUIRE_EQ(code, CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(size, count);
+		REQUIRE_EQ(largeAllocations, 1);
+	}
+
+	TEST_CASE("Snapshot does not depend on the parser arena") {
+		CountingResource resource;
+		CMD::CommandLineArgs parser(&resource);
+		parser.addParam(CMD::CommandLineArgs::Type::String, "str", "A string", false);
+		char* argv[2] = {"program", "--str=value"};
+		REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		std::shared_ptr<const CMD::ParsedArgs> snapshot = parser.snapshot();
+		parser.freeValues();
+		char* other[2] = {"program", "--str=other"};
+		REQUIRE_EQ(parser.parse(2, other), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(*snapshot->getValue<CMD::CommandLineArgs::Type::String>("str"), "value");
+		REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::String>("str"), "other");
+	}
+}
+
+TEST_SUITE("String Storage") {
+	TEST_CASE("String param as view") {
+		const int argc = 2;
+		char* argv[argc] = {"program", "--stringParam=some/long/path"};
+		CMD::CommandLineArgs parser(CMD::CommandLineArgs::StringStorage::View);
+		parser.addParam(CMD::CommandLineArgs::Type::String, "stringParam", "A string", false);
+		REQUIRE_EQ(parser.parse(argc, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		SUBCASE("Value points into argv") {
+			const std::string_view* str = parser.getValue<CMD::CommandLineArgs::Type::String, std::string_view>("stringParam");
+			REQUIRE_NE(str, nullptr);
+			REQUIRE_EQ(*str, "some/long/path");
+			REQUIRE_EQ(str->data(), argv[1] + strlen("--stringParam="));
+		}
+
+		SUBCASE("Value cannot be accessed as std::string") {
+			REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::String>("stringParam"), nullptr);
+		}
+	}
+
+	TEST_CASE("String list as views") {
+		const int argc = 2;
+		char* argv[argc] = {"program", "--inputs=a.txt,b.txt"};
+		CMD::CommandLineArgs parser(CMD::CommandLineArgs::StringStorage::View);
+		parser.addParam(CMD::CommandLineArgs::Type::StringList, "inputs", "Input files", false);
+		REQUIRE_EQ(parser.parse(argc, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		const std::span<const std::string_view> inputs = *parser.getValue<CMD::CommandLineArgs::Type::StringList>("inputs");
+		REQUIRE_EQ(inputs.size(), 2);
+		REQUIRE_EQ(inputs[0].data(), argv[1] + strlen("--inputs="));
+		REQUIRE_EQ(inputs[1], "b.txt");
+	}
+
+	TEST_CASE("Copied string cannot be accessed as view") {
+		const int argc = 2;
+		char* argv[argc] = {"program", "--stringParam=value"};
+		CMD::CommandLineArgs parser;
+		parser.addParam(CMD::CommandLineArgs::Type::String, "stringParam", "A string", false);
+		REQUIRE_EQ(parser.parse(argc, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		const std::string_view* view = parser.getValue<CMD::CommandLineArgs::Type::String, std::string_view>("stringParam");
+		REQUIRE_EQ(view, nullptr);
+		REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::String>("stringParam"), "value");
+	}
+}
+
+TEST_SUITE("Subcommands") {
+	TEST_CASE("Subcommand parses the arguments after its name") {
+		CMD::CommandLineArgs parser;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "verbose", "Verbose output", false), CMD::CommandLineArgs::ErrorCode::Success);
+		int built = 0;
+		const CMD::CommandLineArgs::ErrorCode buildAdded = parser.addSubcommand("build", "Build the project", [&built](CMD::CommandLineArgs& args) {
+			built++;
+			return args.addParam(CMD::CommandLineArgs::Type::Int, "jobs", "Number of jobs", true);
+		});
+		REQUIRE_EQ(buildAdded, CMD::CommandLineArgs::ErrorCode::Success);
+		// Subcommands which are not passed must not be built
+		int cleanBuilt = 0;
+		const CMD::CommandLineArgs::ErrorCode cleanAdded = parser.addSubcommand("clean", "Remove build files", [&cleanBuilt](CMD::CommandLineArgs&) {
+			cleanBuilt++;
+			return CMD::CommandLineArgs::ErrorCode::Success;
+		});
+		REQUIRE_EQ(cleanAdded, CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addSubcommand("build", "Twice", nullptr), CMD::CommandLineArgs::ErrorCode::ParameterExists);
+
+		SUBCASE("Options before and after the subcommand") {
+			char* argv[4] = {"tool", "--verbose", "build", "--jobs=8"};
+			REQUIRE_EQ(parser.parse(4, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE(*parser.getValue<CMD::CommandLineArgs::Type::Flag>("verbose"));
+			REQUIRE_EQ(parser.getSubcommandName(), "build");
+			const CMD::CommandLineArgs* build = parser.getSubcommand();
+			REQUIRE_NE(build, nullptr);
+			REQUIRE_EQ(*build->getValue<CMD::CommandLineArgs::Type::Int>("jobs"), 8);
+			REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::Int>("jobs"), nullptr);
+			char* again[3] = {"tool", "build", "--jobs=2"};
+			REQUIRE_EQ(parser.parse(3, again), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getSubcommand()->getValue<CMD::CommandLineArgs::Type::Int>("jobs"), 2);
+			REQUIRE_EQ(built, 1);
+			REQUIRE_EQ(cleanBuilt, 0);
+		}
+
+		SUBCASE("Help of the subcommand shows the whole command") {
+			char* argv[3] = {"tool", "build", "--jobs=8"};
+			REQUIRE_EQ(parser.parse(3, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE(parser.getSubcommand()->getHelp().starts_with("Usage: tool build [OPTIONS]"));
+			REQUIRE_EQ(parser.parse(3, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE(parser.getSubcommand()->getHelp().starts_with("Usage: tool build [OPTIONS]"));
+			char* renamed[3] = {"other", "build", "--jobs=8"};
+			REQUIRE_EQ(parser.parse(3, renamed), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE(parser.getSubcommand()->getHelp().starts_with("Usage: other build [OPTIONS]"));
+		}
+
+		SUBCASE("Required parameters are checked per subcommand") {
+			char* argv[2] = {"tool", "build"};
+			REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::MissingParameter);
+		}
+
+		SUBCASE("Missing or unknown subcommand") {
+			char* missing[2] = {"tool", "--verbose"};
+			REQUIRE_EQ(parser.parse(2, missing), CMD::CommandLineArgs::ErrorCode::UnknownSubcommand);
+			REQUIRE_EQ(parser.getSubcommand(), nullptr);
+			char* unknown[2] = {"tool", "deploy"};
+			REQUIRE_EQ(parser.parse(2, unknown), CMD::CommandLineArgs::ErrorCode::UnknownSubcommand);
+		}
+
+		SUBCASE("Parameters of the subcommand are not accepted before its name") {
+			char* argv[3] = {"tool", "--jobs=8", "build"};
+			REQUIRE_EQ(parser.parse(3, argv), CMD::CommandLineArgs::ErrorCode::UnknownParameter);
+		}
+	}
+}
+
+TEST_SUITE("Positional Arguments") {
+	TEST_CASE("Positional arguments are an error by default") {
+		CMD::CommandLineArgs parser;
+		char* argv[2] = {"program", "input.txt"};
+		REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::WrongParamFormat);
+	}
+
+	TEST_CASE("Callback receives the positional arguments in order") {
+		CMD::CommandLineArgs parser;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "threads", "Threads", false), CMD::CommandLineArgs::ErrorCode::Success);
+		std::vector<std::string> received;
+		parser.setPositionalCallback([&received](std::string_view arg) {
+			received.emplace_back(arg);
+			return CMD::CommandLineArgs::ErrorCode::Success;
+		});
+		SUBCASE("Mixed with parameters") {
+			char* argv[6] = {"program", "a.txt", "--threads=2", "-", "--", "--threads=3"};
+			REQUIRE_EQ(parser.parse(6, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>("threads"), 2);
+			REQUIRE_EQ(received.size(), 3);
+			REQUIRE_EQ(received[0], "a.txt");
+			REQUIRE_EQ(received[1], "-");
+			REQUIRE_EQ(received[2], "--threads=3");
+			REQUIRE(parser.getPositionals().empty());
+		}
+
+		SUBCASE("Callback can stop the parsing") {
+			parser.setPositionalCallback([](std::string_view) {
+				return CMD::CommandLineArgs::ErrorCode::WrongValueType;
+			});
+			char* argv[3] = {"program", "a.txt", "--threads=2"};
+			REQUIRE_EQ(parser.parse(3, argv), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+			REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::Int>("threads"), nullptr);
+		}
+	}
+
+	TEST_CASE("Collected positional arguments") {
+		CMD::CommandLineArgs parser;
+		parser.setCollectPositionals(true);
+		std::vector<std::string> storage;
+		std::vector<char*> argv = {const_cast<char*>("program")};
+		const int count = 10000;
+		storage.reserve(count);
+		for (int i = 0; i < count; ++i) {
+			storage.push_back("input_" + std::to_string(i) + ".txt");
+			argv.push_back(storage.back().data());
+		}
+		REQUIRE_EQ(parser.parse(int(argv.size()), argv.data()), CMD::CommandLineArgs::ErrorCode::Success);
+		const std::span<const std::string_view> positionals = parser.getPositionals();
+		REQUIRE_EQ(positionals.size(), count);
+		REQUIRE_EQ(positionals[0], "input_0.txt");
+		REQUIRE_EQ(positionals[count - 1], "input_9999.txt");
+		const std::shared_ptr<const CMD::ParsedArgs> snapshot = parser.snapshot();
+		parser.freeValues();
+		REQUIRE(parser.getPositionals().empty());
+		REQUIRE_EQ(snapshot->getPositionals().size(), count);
+		REQUIRE_EQ(snapshot->getPositionals()[1], "input_1.txt");
+	}
+}
+
+/// Endpoint written as host:port
+struct Endpoint {
+	std::string host;
+	uint16_t port = 0;
+	bool operator==(const Endpoint&) const = default;
+};
+
+template<>
+struct CMD::ValueParser<Endpoint> {
+	static bool parse(std::string_view text, Endpoint& out) {
+		const std::size_t colon = text.rfind(':');
+		if (colon == std::string_view::npos || colon == 0) {
+			return false;
+		}
+		const std::string_view port = text.substr(colon + 1);
+		const auto [end, error] = std::from_chars(port.data(), port.data() + port.size(), out.port);
+		if (error != std::errc() || end != port.data() + port.size()) {
+			return false;
+		}
+		out.host = text.substr(0, colon);
+		return true;
+	}
+};
+
+/// Duration written as a number followed by ms or s
+template<>
+struct CMD::ValueParser<std::chrono::milliseconds> {
+	static bool parse(std::string_view text, std::chrono::milliseconds& out) {
+		int64_t count;
+		const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), count);
+		const std::string_view unit(end, text.data() + text.size());
+		if (error != std::errc() || (unit != "ms" && unit != "s")) {
+			return false;
+		}
+		out = std::chrono::milliseconds(unit == "s" ? count * 1000 : count);
+		return true;
+	}
+};
+
+TEST_SUITE("Custom Types") {
+	TEST_CASE("Values are converted once and stored") {
+		CMD::CommandLineArgs parser;
+		CMD::CommandLineArgs::ParamId timeout;
+		REQUIRE_EQ(parser.addParam<std::chrono::milliseconds>("timeout", "Timeout", true, &timeout), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam<Endpoint>("listen", "Address to listen on", false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam<Endpoint>("upstream", "Upstream server", false), CMD::CommandLineArgs::ErrorCode::Success);
+		char* argv[3] = {"program", "--timeout=2s", "--listen=localhost:8080"};
+		REQUIRE_EQ(parser.parse(3, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(*parser.getValue<std::chrono::milliseconds>(timeout), std::chrono::milliseconds(2000));
+		const Endpoint* listen = parser.getValue<Endpoint>("listen");
+		REQUIRE(listen);
+		REQUIRE_EQ(listen->host, "localhost");
+		REQUIRE_EQ(listen->port, 8080);
+		REQUIRE_EQ(parser.getValue<Endpoint>("upstream"), nullptr);
+		REQUIRE_EQ(parser.getValue<Endpoint>("timeout"), nullptr);
+		REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::String>("listen"), nullptr);
+
+		const std::shared_ptr<const CMD::ParsedArgs> snapshot = parser.snapshot();
+		parser.freeValues();
+		REQUIRE_EQ(parser.getValue<Endpoint>("listen"), nullptr);
+		REQUIRE_EQ(snapshot->getValue<Endpoint>("listen")->port, 8080);
+
+		// Only whether the parameter was passed is serialized
+		const std::vector<std::byte> blob = snapshot->serialize();
+		CMD::SerializedArgs serialized;
+		REQUIRE_EQ(serialized.open(blob), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(serialized.getSource(serialized.getParamId("listen")), CMD::CommandLineArgs::Source::CommandLine);
+	}
+
+	TEST_CASE("Bound variable receives the value") {
+		CMD::CommandLineArgs parser;
+		Endpoint listen{"0.0.0.0", 80};
+		Endpoint upstream{"backend", 9000};
+		REQUIRE_EQ(parser.addParam("listen", "Address to listen on", &listen, false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam("upstream", "Upstream server", &upstream, false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam<Endpoint>("missing", "No variable", static_cast<Endpoint*>(nullptr), false), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+		char* argv[2] = {"program", "--listen=example.com:443"};
+		REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(listen.host, "example.com");
+		REQUIRE_EQ(listen.port, 443);
+		REQUIRE_EQ(upstream.port, 9000);
+	}
+
+	TEST_CASE("Errors") {
+		CMD::CommandLineArgs parser;
+		REQUIRE_EQ(parser.addParam<std::chrono::milliseconds>("timeout", "Timeout", false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam<std::chrono::milliseconds>("timeout", "Timeout", false), CMD::CommandLineArgs::ErrorCode::ParameterExists);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Custom, "other", "No C++ type", false), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+		char* wrong[2] = {"program", "--timeout=2h"};
+		REQUIRE_EQ(parser.parse(2, wrong), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+		char* missing[2] = {"program", "--timeout"};
+		REQUIRE_EQ(parser.parse(2, missing), CMD::CommandLineArgs::ErrorCode::MissingValue);
+	}
+
+	TEST_CASE("Changed values are reported") {
+		CMD::CommandLineArgs parser;
+		CMD::CommandLineArgs::ParamId timeout;
+		REQUIRE_EQ(parser.addParam<std::chrono::milliseconds>("timeout", "Timeout", false, &timeout), CMD::CommandLineArgs::ErrorCode::Success);
+		char* first[2] = {"program", "--timeout=1s"};
+		char* same[2] = {"program", "--timeout=1000ms"};
+		char* other[2] = {"program", "--timeout=5s"};
+		std::shared_ptr<const CMD::ParsedArgs> a;
+		std::shared_ptr<const CMD::ParsedArgs> b;
+		std::shared_ptr<const CMD::ParsedArgs> c;
+		REQUIRE_EQ(parser.parse(2, first, a), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.parse(2, same, b), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.parse(2, other, c), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE(a->changedParams(*b).empty());
+		REQUIRE_EQ(a->changedParams(*c).size(), 1);
+		REQUIRE_EQ(*c->getValue<std::chrono::milliseconds>(timeout), std::chrono::milliseconds(5000));
+	}
+}
+
+TEST_SUITE("Validators") {
+	TEST_CASE("All rejected values are reported") {
+		CMD::CommandLineArgs parser;
+		CMD::CommandLineArgs::ParamId port;
+		CMD::CommandLineArgs::ParamId inputs;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "port", "Port", false, &port), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::String, "input", "Input", false, &inputs), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "verbose", "Verbose", false), CMD::CommandLineArgs::ErrorCode::Success);
+		const auto checkPort = [](std::string_view value, std::string& message) {
+			if (std::stoi(std::string(value)) > 65535) {
+				message = "Port must be at most 65535";
+				return false;
+			}
+			return true;
+		};
+		const auto checkInput = [](std::string_view value, std::string& message) {
+			if (value.starts_with("missing")) {
+				message = "File does not exist";
+				return false;
+			}
+			return true;
+		};
+		REQUIRE_EQ(parser.setValidator(port, checkPort), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.setValidator(inputs, checkInput), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.setValidator(100, nullptr), CMD::CommandLineArgs::ErrorCode::UnknownParameter);
+
+		unsigned threads = 1;
+		SUBCASE("Calling thread") {
+			threads = 1;
+		}
+		SUBCASE("Many threads") {
+			threads = 4;
+		}
+		parser.setValidationThreads(threads);
+
+		char* valid[4] = {"program", "--port=8080", "--input=a.txt", "--verbose"};
+		REQUIRE_EQ(parser.parse(4, valid), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE(parser.getValidationErrors().empty());
+
+		char* invalid[5] = {"program", "--input=missing1.txt", "--port=70000", "--input=a.txt", "--input=missing2.txt"};
+		REQUIRE_EQ(parser.parse(5, invalid), CMD::CommandLineArgs::ErrorCode::ValidationFailed);
+		const std::span<const CMD::CommandLineArgs::ValidationError> errors = parser.getValidationErrors();
+		REQUIRE_EQ(errors.size(), 3);
+		REQUIRE_EQ(errors[0].id, inputs);
+		REQUIRE_EQ(errors[0].value, "missing1.txt");
+		REQUIRE_EQ(errors[0].message, "File does not exist");
+		REQUIRE_EQ(errors[1].id, port);
+		REQUIRE_EQ(errors[1].value, "70000");
+		REQUIRE_EQ(errors[1].message, "Port must be at most 65535");
+		REQUIRE_EQ(errors[2].value, "missing2.txt");
+
+		std::shared_ptr<const CMD::ParsedArgs> snapshot;
+		std::vector<CMD::CommandLineArgs::ValidationError> snapshotErrors(1);
+		REQUIRE_EQ(parser.parse(5, invalid, snapshot, nullptr, &snapshotErrors), CMD::CommandLineArgs::ErrorCode::ValidationFailed);
+		REQUIRE(snapshot == nullptr);
+		REQUIRE_EQ(snapshotErrors.size(), 3);
+		REQUIRE_EQ(snapshotErrors[1].id, port);
+		REQUIRE_EQ(snapshotErrors[2].value, "missing2.txt");
+		REQUIRE_EQ(parser.parse(4, valid, snapshot, nullptr, &snapshotErrors), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE(snapshotErrors.empty());
+		const CMD::CommandLineArgs::Arguments batch[2] = {{4, valid}, {5, invalid}};
+		const std::vector<CMD::CommandLineArgs::BatchResult> results = parser.parseBatch(batch, threads);
+		REQUIRE(results[0].validationErrors.empty());
+		REQUIRE_EQ(results[1].validationErrors.size(), 3);
+		REQUIRE_EQ(results[1].validationErrors[0].message, "File does not exist");
+		REQUIRE_EQ(parser.setValidator(inputs, nullptr), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.parse(5, invalid), CMD::CommandLineArgs::ErrorCode::ValidationFailed);
+		REQUIRE_EQ(parser.getValidationErrors().size(), 1);
+	}
+
+	TEST_CASE("Every value is validated once") {
+		CMD::CommandLineArgs parser(CMD::CommandLineArgs::StringStorage::View);
+		CMD::CommandLineArgs::ParamId inputs;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::StringList, "inputs", "Inputs", false, &inputs), CMD::CommandLineArgs::ErrorCode::Success);
+		const int count = 10000;
+		std::vector<std::atomic<int>> calls(count);
+		const auto countCall = [&calls](std::string_view value, std::string&) {
+			calls[std::stoi(std::string(value))].fetch_add(1);
+			return true;
+		};
+		REQUIRE_EQ(parser.setValidator(inputs, countCall), CMD::CommandLineArgs::ErrorCode::Success);
+		parser.setValidationThreads(0);
+		std::vector<std::string> storage;
+		std::vector<char*> argv = {const_cast<char*>("program")};
+		storage.reserve(count);
+		for (int i = 0; i < count; ++i) {
+			storage.push_back("--inputs=" + std::to_string(i));
+			argv.push_back(storage.back().data());
+		}
+		REQUIRE_EQ(parser.parse(int(argv.size()), argv.data()), CMD::CommandLineArgs::ErrorCode::Success);
+		bool allOnce = true;
+		for (const std::atomic<int>& call : calls) {
+			allOnce = allOnce && call.load() == 1;
+		}
+		REQUIRE(allOnce);
+	}
+}
+
+TEST_SUITE("Response Files") {
+	std::string writeFile(const char* name, const std::string& content) {
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+		std::ofstream(path, std::ios::binary) << content;
+		return "@" + path.string();
+	}
+
+	TEST_CASE("Arguments are read from the file") {
+		CMD::CommandLineArgs parser;
+		parser.addParam(CMD::CommandLineArgs::Type::Int, "threads", "Threads", false);
+		parser.addParam(CMD::CommandLineArgs::Type::String, "out", "Output", true);
+		parser.addParam(CMD::CommandLineArgs::Type::Flag, "flag", "A flag", false);
+		SUBCASE("Mixed with argv") {
+			std::string file = writeFile("cmd_line_args_simple.rsp", "--threads=8\n\t--out=a.txt ");
+			char* argv[3] = {"program", file.data(), "--flag"};
+			REQUIRE_EQ(parser.parse(3, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>("threads"), 8);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::String>("out"), "a.txt");
+			REQUIRE(*parser.getValue<CMD::CommandLineArgs::Type::Flag>("flag"));
+		}
+
+		SUBCASE("Quotes and escapes") {
+			std::string file = writeFile("cmd_line_args_quotes.rsp", "--out='some file' --threads=\"1\"2");
+			char* argv[2] = {"program", file.data()};
+			REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::String>("out"), "some file");
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>("threads"), 12);
+			std::string escaped = writeFile("cmd_line_args_escaped.rsp", "--out=a\\ \"b \\\"c\\\"\"");
+			char* escapedArgv[2] = {"program", escaped.data()};
+			REQUIRE_EQ(parser.parse(2, escapedArgv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::String>("out"), "a b \"c\"");
+		}
+
+		SUBCASE("Nested files") {
+			std::string inner = writeFile("cmd_line_args_inner.rsp", "--threads=3");
+			std::string outer = writeFile("cmd_line_args_outer.rsp", inner + " --out=b.txt");
+			char* argv[2] = {"program", outer.data()};
+			REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>("threads"), 3);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::String>("out"), "b.txt");
+		}
+
+		SUBCASE("Errors") {
+			std::string self = std::filesystem::path(std::filesystem::temp_directory_path() / "cmd_line_args_self.rsp").string();
+			std::string file = writeFile("cmd_line_args_self.rsp", "@" + self);
+			char* argv[2] = {"program", file.data()};
+			REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::ResponseFileError);
+			char* missing[2] = {"program", "@cmd_line_args_file_which_does_not_exist.rsp"};
+			REQUIRE_EQ(parser.parse(2, missing), CMD::CommandLineArgs::ErrorCode::ResponseFileError);
+			std::string unclosed = writeFile("cmd_line_args_unclosed.rsp", "--out='a.txt");
+			char* unclosedArgv[2] = {"program", unclosed.data()};
+			REQUIRE_EQ(parser.parse(2, unclosedArgv), CMD::CommandLineArgs::ErrorCode::ResponseFileError);
+			std::string unknown = writeFile("cmd_line_args_unknown.rsp", "--unknown=1");
+			char* unknownArgv[2] = {"program", unknown.data()};
+			REQUIRE_EQ(parser.parse(2, unknownArgv), CMD::CommandLineArgs::ErrorCode::UnknownParameter);
+		}
+	}
+
+	TEST_CASE("Values in the file are validated") {
+		CMD::CommandLineArgs parser;
+		CMD::CommandLineArgs::ParamId out;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::String, "out", "Output", false, &out), CMD::CommandLineArgs::ErrorCode::Success);
+		const auto checkOut = [](std::string_view value, std::string& message) {
+			message = "Cannot write";
+			return value != "readonly.txt";
+		};
+		REQUIRE_EQ(parser.setValidator(out, checkOut), CMD::CommandLineArgs::ErrorCode::Success);
+		std::string file = writeFile("cmd_line_args_validated.rsp", "--out=readonly.txt");
+		char* argv[2] = {"program", file.data()};
+		REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::ValidationFailed);
+		REQUIRE_EQ(parser.getValidationErrors().size(), 1);
+		REQUIRE_EQ(parser.getValidationErrors()[0].value, "readonly.txt");
+	}
+
+	TEST_CASE("Views point into the file") {
+		CMD::CommandLineArgs parser(CMD::CommandLineArgs::StringStorage::View);
+		parser.addParam(CMD::CommandLineArgs::Type::StringList, "inputs", "Inputs", false);
+		std::string content;
+		const int count = 100000;
+		for (int i = 0; i < count; ++i) {
+			content += "--inputs=file" + std::to_string(i) + ".txt\n";
+		}
+		std::string file = writeFile("cmd_line_args_large.rsp", content);
+		char* argv[2] = {"program", file.data()};
+		REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		std::filesystem::remove(std::filesystem::temp_directory_path() / "cmd_line_args_large.rsp");
+		const std::span<const std::string_view> inputs = *parser.getValue<CMD::CommandLineArgs::Type::StringList>("inputs");
+		REQUIRE_EQ(inputs.size(), count);
+		REQUIRE_EQ(inputs[0], "file0.txt");
+		REQUIRE_EQ(inputs[count - 1], "file99999.txt");
+	}
+}
+
+TEST_SUITE("Command Line String") {
+	TEST_CASE("Arguments are split as by a shell") {
+		CMD::CommandLineArgs parser(CMD::CommandLineArgs::StringStorage::View);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "threads", "Threads", true), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::String, "out", "Output", false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::StringList, "tags", "Tags", false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "verbose", "Verbose", false), CMD::CommandLineArgs::ErrorCode::Success);
+		SUBCASE("Plain") {
+			REQUIRE_EQ(parser.parse("  --threads=8\t--verbose   --tags=a,bb,ccc_longer_than_eight_bytes "), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>("threads"), 8);
+			REQUIRE(*parser.getValue<CMD::CommandLineArgs::Type::Flag>("verbose"));
+			const std::span<const std::string_view> tags = *parser.getValue<CMD::CommandLineArgs::Type::StringList>("tags");
+			REQUIRE_EQ(tags.size(), 3);
+			REQUIRE_EQ(tags[2], "ccc_longer_than_eight_bytes");
+		}
+
+		SUBCASE("Quotes and escapes") {
+			std::string commandLine = "--threads=\"1\"6 --out=\"/data/x y\"";
+			REQUIRE_EQ(parser.parse(commandLine), CMD::CommandLineArgs::ErrorCode::Success);
+			// The values do not point into the string
+			commandLine.assign(commandLine.size(), ' ');
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>("threads"), 16);
+			const std::string_view* out = parser.getValue<CMD::CommandLineArgs::Type::String, std::string_view>("out");
+			REQUIRE_EQ(*out, "/data/x y");
+			REQUIRE_EQ(parser.parse("--threads=1 --out=a\\ b\\\\c 'it''s'"), CMD::CommandLineArgs::ErrorCode::WrongParamFormat);
+			REQUIRE_EQ(parser.parse("--threads=1 --out=a\\ b\\\\c"), CMD::CommandLineArgs::ErrorCode::Success);
+			out = parser.getValue<CMD::CommandLineArgs::Type::String, std::string_view>("out");
+			REQUIRE_EQ(*out, "a b\\c");
+		}
+
+		SUBCASE("Errors") {
+			REQUIRE_EQ(parser.parse("--out=a"), CMD::CommandLineArgs::ErrorCode::MissingParameter);
+			REQUIRE_EQ(parser.parse(""), CMD::CommandLineArgs::ErrorCode::MissingParameter);
+			REQUIRE_EQ(parser.parse("--threads=1 --out='a"), CMD::CommandLineArgs::ErrorCode::UnclosedQuote);
+			REQUIRE_EQ(parser.parse("--threads=x"), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+		}
+	}
+
+	TEST_CASE("Positional arguments and snapshots") {
+		CMD::CommandLineArgs parser;
+		parser.setCollectPositionals(true);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "threads", "Threads", false), CMD::CommandLineArgs::ErrorCode::Success);
+		std::shared_ptr<const CMD::ParsedArgs> args;
+		REQUIRE_EQ(parser.parse("input.txt --threads=2 -- --not-a-param", args), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(*args->getValue<CMD::CommandLineArgs::Type::Int>("threads"), 2);
+		REQUIRE_EQ(args->getPositionals().size(), 2);
+		REQUIRE_EQ(args->getPositionals()[0], "input.txt");
+		REQUIRE_EQ(args->getPositionals()[1], "--not-a-param");
+		REQUIRE_EQ(parser.parse("--threads=\"2", args), CMD::CommandLineArgs::ErrorCode::UnclosedQuote);
+		REQUIRE_FALSE(args);
+	}
+}
+
+TEST_SUITE("Short Options") {
+	TEST_CASE("Values and bundles") {
+		CMD::CommandLineArgs parser;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "jobs", "Number of jobs", false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "verbose", "Verbose", false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "extract", "Extract", false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::String, "out", "Output", false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.setShortName(0, 'j'), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.setShortName(1, 'v'), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.setShortName(2, 'x'), CMD::CommandLineArgs::ErrorCode::Success);
+
+		SUBCASE("Attached and separate values") {
+			char* attached[2] = {"program", "-j8"};
+			REQUIRE_EQ(parser.parse(2, attached), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>(0), 8);
+			char* separate[3] = {"program", "-j", "-4"};
+			REQUIRE_EQ(parser.parse(3, separate), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>(0), -4);
+		}
+
+		SUBCASE("Flags are bundled and the last option takes a value") {
+			char* flags[2] = {"program", "-vx"};
+			REQUIRE_EQ(parser.parse(2, flags), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE(*parser.getValue<CMD::CommandLineArgs::Type::Flag>(1));
+			REQUIRE(*parser.getValue<CMD::CommandLineArgs::Type::Flag>(2));
+			parser.freeValues();
+			char* withValue[3] = {"program", "-xj", "16"};
+			REQUIRE_EQ(parser.parse(3, withValue), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_FALSE(*parser.getValue<CMD::CommandLineArgs::Type::Flag>(1));
+			REQUIRE(*parser.getValue<CMD::CommandLineArgs::Type::Flag>(2));
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>(0), 16);
+			char* attached[2] = {"program", "-vj32"};
+			REQUIRE_EQ(parser.parse(2, attached), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>(0), 32);
+		}
+
+		SUBCASE("Long names take the next argument") {
+			char* argv[5] = {"program", "--out", "/data/x y", "--jobs", "2"};
+			REQUIRE_EQ(parser.parse(5, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::String>(3), "/data/x y");
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>(0), 2);
+		}
+
+		SUBCASE("Errors") {
+			char* missing[2] = {"program", "-vj"};
+			REQUIRE_EQ(parser.parse(2, missing), CMD::CommandLineArgs::ErrorCode::MissingValue);
+			char* unknown[2] = {"program", "-vq"};
+			REQUIRE_EQ(parser.parse(2, unknown), CMD::CommandLineArgs::ErrorCode::UnknownParameter);
+			char* wrongValue[2] = {"program", "-jx"};
+			REQUIRE_EQ(parser.parse(2, wrongValue), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+			// An argument which does not start with a known short name keeps the old meaning
+			char* notShort[2] = {"program", "-q"};
+			REQUIRE_EQ(parser.parse(2, notShort), CMD::CommandLineArgs::ErrorCode::WrongParamFormat);
+		}
+
+		SUBCASE("Command line string") {
+			REQUIRE_EQ(parser.parse("-vj 8 --out 'a b'"), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>(0), 8);
+			REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::String>(3), "a b");
+			REQUIRE_EQ(parser.parse("--out"), CMD::CommandLineArgs::ErrorCode::MissingValue);
+		}
+
+		SUBCASE("Description") {
+			const std::string description = parser.getDescription();
+			REQUIRE_NE(description.find("  -j, --jobs <int>"), std::string::npos);
+			REQUIRE_NE(description.find("      --out <string>"), std::string::npos);
+		}
+	}
+
+	TEST_CASE("Short names are unique") {
+		CMD::CommandLineArgs parser;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "verbose", "Verbose", false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "version", "Version", false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.setShortName(0, 'v'), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.setShortName(0, 'v'), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.setShortName(1, 'v'), CMD::CommandLineArgs::ErrorCode::ParameterExists);
+		REQUIRE_EQ(parser.setShortName(1, '-'), CMD::CommandLineArgs::ErrorCode::WrongParamFormat);
+		REQUIRE_EQ(parser.setShortName(2, 'x'), CMD::CommandLineArgs::ErrorCode::UnknownParameter);
+		// Renaming frees the old name
+		REQUIRE_EQ(parser.setShortName(0, 'V'), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.setShortName(1, 'v'), CMD::CommandLineArgs::ErrorCode::Success);
+		char* argv[2] = {"program", "-v"};
+		REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_FALSE(*parser.getValue<CMD::CommandLineArgs::Type::Flag>(0));
+		REQUIRE(*parser.getValue<CMD::CommandLineArgs::Type::Flag>(1));
+		REQUIRE_EQ(parser.setShortName(1, '\0'), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.parse(2, argv), CMD::CommandLineArgs::ErrorCode::WrongParamFormat);
+	}
+
+	TEST_CASE("Values before a subcommand") {
+		CMD::CommandLineArgs parser;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::String, "config", "Config", false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.setShortName(0, 'c'), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addSubcommand("build", "Build", [](CMD::CommandLineArgs& args) {
+			return args.addParam(CMD::CommandLineArgs::Type::Int, "jobs", "Number of jobs", true);
+		}), CMD::CommandLineArgs::ErrorCode::Success);
+		// The value of --config is named like the subcommand and must not start it
+		char* argv[6] = {"tool", "--config", "build", "-c", "build", "build"};
+		char* rest[7] = {"tool", "--config", "build", "-c", "build", "build", "--jobs=3"};
+		REQUIRE_EQ(parser.parse(6, argv), CMD::CommandLineArgs::ErrorCode::MissingParameter);
+		REQUIRE_EQ(parser.parse(7, rest), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::String>(0), "build");
+		REQUIRE_EQ(*parser.getSubcommand()->getValue<CMD::CommandLineArgs::Type::Int>("jobs"), 3);
+	}
+}
+
+TEST_SUITE("Help") {
+	CMD::CommandLineArgs::ErrorCode addHelpParams(CMD::CommandLineArgs& parser) {
+		CMD::CommandLineArgs::ParamId jobs;
+		if (
+			parser.addParam(CMD::CommandLineArgs::Type::Flag, "verbose", "Verbose output", false) != CMD::CommandLineArgs::ErrorCode::Success ||
+			parser.addParam(CMD::CommandLineArgs::Type::Int, "jobs", "Number of jobs", true, &jobs) != CMD::CommandLineArgs::ErrorCode::Success ||
+			parser.addParam(CMD::CommandLineArgs::Type::String, "out", "Output file", false) != CMD::CommandLineArgs::ErrorCode::Success
+		) {
+			return CMD::CommandLineArgs::ErrorCode::ParameterExists;
+		}
+		return parser.setShortName(jobs, 'j');
+	}
+
+	TEST_CASE("Sorted and aligned") {
+		CMD::CommandLineArgs parser;
+		REQUIRE_EQ(addHelpParams(parser), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addSubcommand("clean", "Remove build files", nullptr), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addSubcommand("build", "Build the project", nullptr), CMD::CommandLineArgs::ErrorCode::Success);
+		const std::string_view expected =
+			"Usage: <program_name> [OPTIONS] COMMAND [COMMAND OPTIONS]\n"
+			"\n"
+			"Options:\n"
+			"  -j, --jobs <int>    Number of jobs [REQUIRED]\n"
+			"      --out <string>  Output file\n"
+			"      --verbose       Verbose output\n"
+			"\n"
+			"Commands:\n"
+			"  build  Build the project\n"
+			"  clean  Remove build files\n";
+		REQUIRE_EQ(parser.getHelp(), expected);
+		REQUIRE_EQ(parser.getDescription(), expected);
+
+		SUBCASE("Wrapped at the width") {
+			parser.setHelpWidth(40);
+			const std::string_view help = parser.getHelp();
+			REQUIRE_NE(help.find("  -j, --jobs <int>    Number of jobs\n                      [REQUIRED]\n"), std::string_view::npos);
+			parser.setHelpWidth(0);
+			REQUIRE_EQ(parser.getHelp(), expected);
+		}
+
+		SUBCASE("Cached until the parameters change") {
+			const char* cached = parser.getHelp().data();
+			REQUIRE_EQ(parser.getHelp().data(), cached);
+			char* argv[3] = {"tool", "--jobs=1", "deploy"};
+			REQUIRE_EQ(parser.parse(3, argv), CMD::CommandLineArgs::ErrorCode::UnknownSubcommand);
+			REQUIRE(parser.getHelp().starts_with("Usage: tool [OPTIONS]"));
+			REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Double, "a-long-parameter-name-which-does-not-fit", "Ratio", false), CMD::CommandLineArgs::ErrorCode::Success);
+			REQUIRE_NE(parser.getHelp().find("      --a-long-parameter-name-which-does-not-fit <number>\n                                          Ratio\n"), std::string_view::npos);
+		}
+	}
+
+	TEST_CASE("Sinks") {
+		CMD::CommandLineArgs parser;
+		REQUIRE_EQ(addHelpParams(parser), CMD::CommandLineArgs::ErrorCode::Success);
+		const std::string_view help = parser.getHelp();
+
+		std::ostringstream stream;
+		parser.printHelp(stream);
+		REQUIRE_EQ(stream.str(), help);
+
+		std::string text;
+		parser.printHelp(std::back_inserter(text));
+		REQUIRE_EQ(text, help);
+		std::vector<char> buffer(help.size());
+		REQUIRE_EQ(parser.printHelp(buffer.data()), buffer.data() + buffer.size());
+		REQUIRE_EQ(std::string_view(buffer.data(), buffer.size()), help);
+
+		std::FILE* file = std::tmpfile();
+		REQUIRE_NE(file, nullptr);
+		parser.printHelp(file);
+		std::rewind(file);
+		std::string fromFile(help.size() + 1, '\0');
+		fromFile.resize(std::fread(fromFile.data(), 1, fromFile.size(), file));
+		std::fclose(file);
+		REQUIRE_EQ(fromFile, help);
+	}
+
+	TEST_CASE("Completion scripts contain options and subcommands") {
+		CMD::CommandLineArgs parser;
+		REQUIRE_EQ(addHelpParams(parser), CMD::CommandLineArgs::ErrorCode::Success);
+		int built = 0;
+		REQUIRE_EQ(parser.addSubcommand("build", "Build the project", [&built](CMD::CommandLineArgs& args) {
+			built++;
+			return args.addParam(CMD::CommandLineArgs::Type::StringList, "target", "It's a target [name]", false);
+		}), CMD::CommandLineArgs::ErrorCode::Success);
+
+		SUBCASE("Bash") {
+			const std::string script = parser.getCompletionScript(CMD::CommandLineArgs::Shell::Bash, "my-tool");
+			REQUIRE_NE(script.find("_my_tool_complete() {"), std::string::npos);
+			REQUIRE_NE(script.find("case \"$prev\" in '--out') COMPREPLY=($(compgen -f -- \"$cur\")); return ;; esac"), std::string::npos);
+			REQUIRE_NE(script.find("compgen -W '--jobs -j --out --verbose build'"), std::string::npos);
+			REQUIRE_NE(script.find("compgen -W '--target'"), std::string::npos);
+			REQUIRE_NE(script.find("complete -F _my_tool_complete 'my-tool'"), std::string::npos);
+			REQUIRE_EQ(built, 1);
+		}
+
+		SUBCASE("Zsh") {
+			char* argv[5] = {"/usr/bin/tool", "-j", "2", "build", "--target=a"};
+			REQUIRE_EQ(parser.parse(5, argv), CMD::CommandLineArgs::ErrorCode::Success);
+			const std::string script = parser.getCompletionScript(CMD::CommandLineArgs::Shell::Zsh);
+			REQUIRE(script.starts_with("#compdef tool\n"));
+			REQUIRE_NE(script.find("'(-j --jobs)'{'-j+','--jobs='}'[Number of jobs]:jobs: '"), std::string::npos);
+			REQUIRE_NE(script.find("'--out=[Output file]:out:_files'"), std::string::npos);
+			REQUIRE_NE(script.find("'*--target=[It'\\''s a target \\[name\\]]:target: '"), std::string::npos);
+			REQUIRE_NE(script.find("'build:Build the project'"), std::string::npos);
+			// The subcommand was built by the parse, its factory is not called again
+			REQUIRE_EQ(built, 1);
+		}
+	}
+}
+
+TEST_SUITE("Sources") {
+	void setEnvironment(const char* name, const char* value) {
+#ifdef _WIN32
+		_putenv_s(name, value ? value : "");
+#else
+		if (value) {
+			setenv(name, value, 1);
+		} else {
+			unsetenv(name);
+		}
+#endif
+	}
+
+	std::string writeConfig(const char* name, const std::string& content) {
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+		std::ofstream(path, std::ios::binary) << content;
+		return path.string();
+	}
+
+	TEST_CASE("Later sources override earlier ones") {
+		CMD::CommandLineArgs parser;
+		CMD::CommandLineArgs::ParamId threads;
+		CMD::CommandLineArgs::ParamId out;
+		CMD::CommandLineArgs::ParamId verbose;
+		CMD::CommandLineArgs::ParamId inputs;
+		CMD::CommandLineArgs::ParamId port;
+		CMD::CommandLineArgs::ParamId name;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "threads", "Threads", false, &threads), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::String, "out", "Output", false, &out), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "verbose", "Verbose", false, &verbose), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::StringList, "inputs", "Inputs", false, &inputs), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "server.port", "Port", true, &port), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::String, "name", "Name", false, &name), CMD::CommandLineArgs::ErrorCode::Success);
+		std::string config = writeConfig(
+			"cmd_line_args_config.ini",
+			"# comment\n"
+			"threads = 4\r\n"
+			"out = \"from config.txt\"\n"
+			"verbose\n"
+			"\n"
+			"inputs=a.txt,b.txt\n"
+			"[ server ]\n"
+			"; comment\n"
+			"port=80"
+		);
+		setEnvironment("CMD_TEST_THREADS", "8");
+		setEnvironment("CMD_TEST_VERBOSE", "off");
+		CMD::CommandLineArgs::Sources sources;
+		sources.configFile = config.c_str();
+		sources.environmentPrefix = "CMD_TEST_";
+		char* argv[2] = {"program", "--inputs=c.txt"};
+		REQUIRE_EQ(parser.parse(2, argv, sources), CMD::CommandLineArgs::ErrorCode::Success);
+		setEnvironment("CMD_TEST_THREADS", nullptr);
+		setEnvironment("CMD_TEST_VERBOSE", nullptr);
+
+		REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>(threads), 8);
+		REQUIRE_EQ(parser.getSource(threads), CMD::CommandLineArgs::Source::Environment);
+		REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::String>(out), "from config.txt");
+		REQUIRE_EQ(parser.getSource(out), CMD::CommandLineArgs::Source::ConfigFile);
+		REQUIRE_FALSE(*parser.getValue<CMD::CommandLineArgs::Type::Flag>(verbose));
+		REQUIRE_EQ(parser.getSource(verbose), CMD::CommandLineArgs::Source::Environment);
+		const std::span<const std::string_view> inputValues = *parser.getValue<CMD::CommandLineArgs::Type::StringList>(inputs);
+		REQUIRE_EQ(inputValues.size(), 1);
+		REQUIRE_EQ(inputValues[0], "c.txt");
+		REQUIRE_EQ(parser.getSource(inputs), CMD::CommandLineArgs::Source::CommandLine);
+		REQUIRE_EQ(*parser.getValue<CMD::CommandLineArgs::Type::Int>(port), 80);
+		REQUIRE_EQ(parser.getSource(name), CMD::CommandLineArgs::Source::Default);
+		REQUIRE_EQ(parser.snapshot()->getSource(port), CMD::CommandLineArgs::Source::ConfigFile);
+	}
+
+	TEST_CASE("Errors") {
+		CMD::CommandLineArgs parser;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "threads", "Threads", false), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "verbose", "Verbose", false), CMD::CommandLineArgs::ErrorCode::Success);
+		char* argv[1] = {"program"};
+		CMD::CommandLineArgs::Sources sources;
+		SUBCASE("Missing file") {
+			sources.configFile = "cmd_line_args_config_which_does_not_exist.ini";
+			REQUIRE_EQ(parser.parse(1, argv, sources), CMD::CommandLineArgs::ErrorCode::ConfigFileError);
+		}
+		SUBCASE("Invalid line") {
+			std::string config = writeConfig("cmd_line_args_invalid.ini", "threads=1\n[section\n");
+			sources.configFile = config.c_str();
+			REQUIRE_EQ(parser.parse(1, argv, sources), CMD::CommandLineArgs::ErrorCode::ConfigFileError);
+		}
+		SUBCASE("Unknown key") {
+			std::string config = writeConfig("cmd_line_args_unknown.ini", "jobs=1");
+			sources.configFile = config.c_str();
+			REQUIRE_EQ(parser.parse(1, argv, sources), CMD::CommandLineArgs::ErrorCode::UnknownParameter);
+		}
+		SUBCASE("Wrong values") {
+			std::string config = writeConfig("cmd_line_args_wrong.ini", "verbose=maybe");
+			sources.configFile = config.c_str();
+			REQUIRE_EQ(parser.parse(1, argv, sources), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+			setEnvironment("CMD_TEST_THREADS", "many");
+			CMD::CommandLineArgs::Sources environment;
+			environment.environmentPrefix = "CMD_TEST_";
+			REQUIRE_EQ(parser.parse(1, argv, environment), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+			setEnvironment("CMD_TEST_THREADS", nullptr);
+		}
+		SUBCASE("Flag value in argv") {
+			char* flagArgv[2] = {"program", "--verbose=true"};
+			REQUIRE_EQ(parser.parse(2, flagArgv, sources), CMD::CommandLineArgs::ErrorCode::FlagHasValue);
+		}
+	}
+}
+
+TEST_SUITE("Reload") {
+	TEST_CASE("Reload publishes a new snapshot and reports the changes") {
+		CMD::CommandLineArgs parser;
+		CMD::CommandLineArgs::ParamId threads;
+		CMD::CommandLineArgs::ParamId cache;
+		CMD::CommandLineArgs::ParamId verbose;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "threads", "Threads", true, &threads), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Size, "cache", "Cache size", false, &cache), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "verbose", "Verbose", false, &verbose), CMD::CommandLineArgs::ErrorCode::Success);
+		char* first[3] = {"program", "--threads=4", "--cache=1M"};
+		std::shared_ptr<const CMD::ParsedArgs> initial;
+		REQUIRE_EQ(parser.parse(3, first, initial), CMD::CommandLineArgs::ErrorCode::Success);
+		CMD::ReloadableArgs live(parser, initial);
+		std::vector<CMD::CommandLineArgs::ParamId> changed;
+		int notifications = 0;
+		live.setChangeCallback([&](const CMD::ParsedArgs&, const CMD::ParsedArgs&, std::span<const CMD::CommandLineArgs::ParamId> ids) {
+			changed.assign(ids.begin(), ids.end());
+			++notifications;
+		});
+
+		const CMD::CommandLineArgs::Sources sources;
+		char* second[4] = {"program", "--threads=8", "--cache=1M", "--verbose"};
+		REQUIRE_EQ(live.reload(4, second, sources), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(notifications, 1);
+		REQUIRE_EQ(changed.size(), 2);
+		REQUIRE_EQ(changed[0], threads);
+		REQUIRE_EQ(changed[1], verbose);
+		{
+			const CMD::ReloadableArgs::Reader args = live.read();
+			REQUIRE(args);
+			REQUIRE_EQ(*args->getValue<CMD::CommandLineArgs::Type::Int>(threads), 8);
+		}
+		REQUIRE_EQ(*initial->getValue<CMD::CommandLineArgs::Type::Int>(threads), 4);
+
+		char* same[4] = {"program", "--verbose", "--threads=8", "--cache=1024K"};
+		REQUIRE_EQ(live.reload(4, same, sources), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(notifications, 1);
+
+		char* wrong[2] = {"program", "--threads=many"};
+		REQUIRE_EQ(live.reload(2, wrong, sources), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+		REQUIRE_EQ(*live.load()->getValue<CMD::CommandLineArgs::Type::Int>(threads), 8);
+	}
+
+	TEST_CASE("Readers run while snapshots are replaced") {
+		CMD::CommandLineArgs parser;
+		CMD::CommandLineArgs::ParamId threads;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "threads", "Threads", true, &threads), CMD::CommandLineArgs::ErrorCode::Success);
+		CMD::ReloadableArgs live(parser);
+		REQUIRE_FALSE(live.read());
+		std::atomic<bool> done = false;
+		std::atomic<int> invalid = 0;
+		std::vector<std::thread> readers;
+		for (int i = 0; i < 4; ++i) {
+			readers.emplace_back([&]() {
+				int last = 0;
+				while (!done.load()) {
+					const CMD::ReloadableArgs::Reader args = live.read();
+					if (!args) {
+						continue;
+					}
+					const int value = *args->getValue<CMD::CommandLineArgs::Type::Int>(threads);
+					// Values are published in increasing order
+					if (value < last) {
+						invalid.fetch_add(1);
+					}
+					last = value;
+				}
+			});
+		}
+		const CMD::CommandLineArgs::Sources sources;
+		for (int i = 1; i <= 200; ++i) {
+			std::string arg = "--threads=" + std::to_string(i);
+			char* argv[2] = {"program", arg.data()};
+			REQUIRE_EQ(live.reload(2, argv, sources), CMD::CommandLineArgs::ErrorCode::Success);
+		}
+		done = true;
+		for (std::thread& reader : readers) {
+			reader.join();
+		}
+		REQUIRE_EQ(invalid.load(), 0);
+		REQUIRE_EQ(*live.load()->getValue<CMD::CommandLineArgs::Type::Int>(threads), 200);
+	}
+}
+
+TEST_SUITE("Serialized Args") {
+	using Type = CMD::CommandLineArgs::Type;
+	using ErrorCode = CMD::CommandLineArgs::ErrorCode;
+
+	void addAllTypes(CMD::CommandLineArgs& parser) {
+		REQUIRE_EQ(parser.addParam(Type::Int, "int", "Int", false), ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(Type::String, "string", "String", false), ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(Type::Flag, "flag", "Flag", false), ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(Type::Int64, "int64", "Int64", false), ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(Type::UInt64, "uint64", "UInt64", false), ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(Type::Double, "double", "Double", false), ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(Type::Size, "size", "Size", false), ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(Type::IntList, "ints", "Int list", false), ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(Type::StringList, "strings", "String list", false), ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(Type::String, "missing", "Not passed", false), ErrorCode::Success);
+	}
+
+	TEST_CASE("Values are read from the blob") {
+		CMD::CommandLineArgs parser;
+		addAllTypes(parser);
+		parser.setCollectPositionals(true);
+		char* argv[] = {
+			"program", "--int=-4", "--string=text", "--flag", "--int64=-9000000000", "--uint64=18000000000",
+			"--double=2.5", "--size=2K", "--ints=1,2,3", "--strings=a,bc", "input.txt"
+		};
+		REQUIRE_EQ(parser.parse(int(std::size(argv)), argv), ErrorCode::Success);
+		const std::vector<std::byte> blob = parser.serialize();
+
+		CMD::SerializedArgs args;
+		REQUIRE_EQ(args.open(blob), ErrorCode::Success);
+		REQUIRE_EQ(*args.getValue<Type::Int>("int"), -4);
+		REQUIRE_EQ(*args.getValue<Type::String>("string"), "text");
+		REQUIRE(*args.getValue<Type::Flag>("flag"));
+		REQUIRE_EQ(*args.getValue<Type::Int64>("int64"), -9000000000);
+		REQUIRE_EQ(*args.getValue<Type::UInt64>("uint64"), 18000000000ull);
+		REQUIRE_EQ(*args.getValue<Type::Double>("double"), 2.5);
+		REQUIRE_EQ(*args.getValue<Type::Size>("size"), 2048);
+		const std::span<const int> ints = *args.getValue<Type::IntList>("ints");
+		REQUIRE_EQ(ints.size(), 3);
+		REQUIRE_EQ(ints[2], 3);
+		const std::span<const std::string_view> strings = *args.getValue<Type::StringList>("strings");
+		REQUIRE_EQ(strings.size(), 2);
+		REQUIRE_EQ(strings[0], "a");
+		REQUIRE_EQ(strings[1], "bc");
+		REQUIRE_EQ(args.getPositionals().size(), 1);
+		REQUIRE_EQ(args.getPositionals()[0], "input.txt");
+
+		REQUIRE_EQ(args.getValue<Type::String>("missing"), nullptr);
+		REQUIRE_EQ(args.getValue<Type::Int>("string"), nullptr);
+		REQUIRE_EQ(args.getValue<Type::Int>("unknown"), nullptr);
+		REQUIRE_EQ(args.getParamId("int"), parser.getParamId("int"));
+		REQUIRE_EQ(args.getParamId("unknown"), CMD::CommandLineArgs::invalidParamId);
+		REQUIRE_EQ(args.getSource(args.getParamId("int")), CMD::CommandLineArgs::Source::CommandLine);
+		REQUIRE_EQ(args.getSource(args.getParamId("missing")), CMD::CommandLineArgs::Source::Default);
+
+		// The blob does not depend on the parser
+		parser.freeValues();
+		REQUIRE_EQ(*args.getValue<Type::String>("string"), "text");
+	}
+
+	TEST_CASE("Snapshot is serialized") {
+		CMD::CommandLineArgs parser;
+		addAllTypes(parser);
+		char* argv[] = {"program", "--int=7"};
+		REQUIRE_EQ(parser.parse(int(std::size(argv)), argv), ErrorCode::Success);
+		const std::vector<std::byte> blob = parser.snapshot()->serialize();
+		REQUIRE(blob == parser.serialize());
+		CMD::SerializedArgs args;
+		REQUIRE_EQ(args.open(blob), ErrorCode::Success);
+		REQUIRE_EQ(*args.getValue<Type::Int>("int"), 7);
+		REQUIRE_FALSE(*args.getValue<Type::Flag>("flag"));
+	}
+
+	TEST_CASE("Invalid blobs are rejected") {
+		CMD::CommandLineArgs parser;
+		addAllTypes(parser);
+		char* argv[] = {"program", "--string=text", "--strings=a,b"};
+		REQUIRE_EQ(parser.parse(int(std::size(argv)), argv), ErrorCode::Success);
+		const std::vector<std::byte> blob = parser.serialize();
+		CMD::SerializedArgs args;
+
+		SUBCASE("Truncated") {
+			for (std::size_t size : {std::size_t(0), std::size_t(8), blob.size() - 8}) {
+				REQUIRE_EQ(args.open(std::span(blob.data(), size)), ErrorCode::InvalidSerializedData);
+			}
+		}
+
+		SUBCASE("Wrong version") {
+			std::vector<std::byte> copy = blob;
+			const uint32_t version = CMD::detail::BlobHeader::currentVersion + 1;
+			std::memcpy(copy.data() + offsetof(CMD::detail::BlobHeader, version), &version, sizeof(version));
+			REQUIRE_EQ(args.open(copy), ErrorCode::InvalidSerializedData);
+		}
+
+		SUBCASE("Misaligned") {
+			std::vector<uint64_t> buffer(blob.size() / 8 + 1);
+			std::byte* const misaligned = reinterpret_cast<std::byte*>(buffer.data()) + 1;
+			std::memcpy(misaligned, blob.data(), blob.size());
+			REQUIRE_EQ(args.open(std::span(misaligned, blob.size())), ErrorCode::InvalidSerializedData);
+		}
+
+		SUBCASE("Offset out of range") {
+			std::vector<std::byte> copy = blob;
+			CMD::detail::BlobHeader header;
+			std::memcpy(&header, copy.data(), sizeof(header));
+			CMD::detail::BlobParam param;
+			const std::size_t offset = header.params + parser.getParamId("strings") * sizeof(param);
+			std::memcpy(&param, copy.data() + offset, sizeof(param));
+			param.size = 1ull << 60;
+			std::memcpy(copy.data() + offset, &param, sizeof(param));
+			REQUIRE_EQ(args.open(copy), ErrorCode::InvalidSerializedData);
+			REQUIRE_EQ(args.getValue<Type::String>("string"), nullptr);
+		}
+
+		SUBCASE("Ids not sorted by name") {
+			std::vector<std::byte> copy = blob;
+			CMD::detail::BlobHeader header;
+			std::memcpy(&header, copy.data(), sizeof(header));
+			REQUIRE_GT(header.paramCount, 2);
+			std::byte* const sortedIds = copy.data() + header.sortedIds;
+			uint32_t ids[2];
+			std::memcpy(ids, sortedIds, sizeof(ids));
+			// Swapped, repeated and out of range ids
+			const uint32_t corrupted[3][2] = {{ids[1], ids[0]}, {ids[0], ids[0]}, {ids[0], header.paramCount}};
+			for (const auto& corruptedIds : corrupted) {
+				std::memcpy(sortedIds, corruptedIds, sizeof(corruptedIds));
+				REQUIRE_EQ(args.open(copy), ErrorCode::InvalidSerializedData);
+				REQUIRE_EQ(args.getParamId("string"), CMD::CommandLineArgs::invalidParamId);
+			}
+			std::memcpy(sortedIds, ids, sizeof(ids));
+			REQUIRE_EQ(args.open(copy), ErrorCode::Success);
+		}
+	}
+}
+
+TEST_SUITE("Instrumentation") {
+	struct CountingObserver : CMD::CommandLineArgs::ParseObserver {
+		void onParse(const CMD::CommandLineArgs::ParseStats& stats) override {
+			parses++;
+			arguments += stats.argumentCount;
+		}
+
+		void onAccess(CMD::CommandLineArgs::ParamId) override {
+			accesses++;
+		}
+
+		void onLookupMiss(std::string_view) override {
+			misses++;
+		}
+
+		uint64_t parses = 0;
+		uint64_t arguments = 0;
+		uint64_t accesses = 0;
+		uint64_t misses = 0;
+	};
+
+	TEST_CASE("Counters") {
+		CMD::CommandLineArgs parser;
+		CMD::CommandLineArgs::ParamId threadsId;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "threads", "Threads", false, &threadsId), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Flag, "flag", "A flag", false), CMD::CommandLineArgs::ErrorCode::Success);
+		CountingObserver observer;
+		parser.setObserver(&observer);
+		char* argv[3] = {"program", "--threads=4", "--flag"};
+		REQUIRE_EQ(parser.parse(3, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_NE(parser.getValue<CMD::CommandLineArgs::Type::Int>("threads"), nullptr);
+		REQUIRE_NE(parser.getValue<CMD::CommandLineArgs::Type::Int>(threadsId), nullptr);
+		REQUIRE_EQ(parser.getValue<CMD::CommandLineArgs::Type::Int>("missing"), nullptr);
+		const CMD::CommandLineArgs::ParseStats stats = parser.getStats();
+		if (CMD::CommandLineArgs::instrumentationEnabled) {
+			REQUIRE_EQ(stats.parseCount, 1);
+			REQUIRE_EQ(stats.argumentCount, 2);
+			REQUIRE_EQ(stats.lookupMisses, 1);
+			REQUIRE_EQ(parser.getAccessCount(threadsId), 2);
+			REQUIRE_EQ(observer.parses, 1);
+			REQUIRE_EQ(observer.arguments, 2);
+			REQUIRE_EQ(observer.accesses, 2);
+			REQUIRE_EQ(observer.misses, 1);
+			parser.resetStats();
+			REQUIRE_EQ(parser.getStats().parseCount, 0);
+			REQUIRE_EQ(parser.getAccessCount(threadsId), 0);
+		} else {
+			REQUIRE_EQ(stats.parseCount, 0);
+			REQUIRE_EQ(parser.getAccessCount(threadsId), 0);
+			REQUIRE_EQ(observer.parses, 0);
+		}
+	}
+
+	TEST_CASE("Batch parse is counted") {
+		CMD::CommandLineArgs parser;
+		REQUIRE_EQ(parser.addParam(CMD::CommandLineArgs::Type::Int, "threads", "Threads", false), CMD::CommandLineArgs::ErrorCode::Success);
+		char* argv[2] = {"program", "--threads=4"};
+		std::vector<CMD::CommandLineArgs::Arguments> inputs(64, CMD::CommandLineArgs::Arguments{2, argv});
+		parser.parseBatch(inputs, 4);
+		const uint64_t expected = CMD::CommandLineArgs::instrumentationEnabled ? 64 : 0;
+		REQUIRE_EQ(parser.getStats().parseCount, expected);
+		REQUIRE_EQ(parser.getStats().argumentCount, expected);
+	}
+}
+
+TEST_SUITE("Static Schema") {
+	using Args = CMD::StaticCommandLineArgs<
+		CMD::Param<"threads", CMD::CommandLineArgs::Type::Int>,
+		CMD::Param<"flag", CMD::CommandLineArgs::Type::Flag>,
+		CMD::Param<"out", CMD::CommandLineArgs::Type::String, true, "Output file">,
+		CMD::Param<"size", CMD::CommandLineArgs::Type::Size>
+	>;
+
+	TEST_CASE("All params are set") {
+		const int argc = 5;
+		char* argv[argc] = {"program", "--threads=8", "--flag", "--out=file.txt", "--size=4M"};
+		Args args;
+		REQUIRE_EQ(args.parse(argc, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(*args.get<"size">(), 4 * 1024 * 1024);
+		REQUIRE_EQ(*args.get<"threads">(), 8);
+		REQUIRE(*args.get<"flag">());
+		REQUIRE_EQ(*args.get<"out">(), "file.txt");
+		REQUIRE_EQ(Args::getDescription<"out">(), "Output file");
+	}
+
+	TEST_CASE("Optional params which are not passed") {
+		const int argc = 2;
+		char* argv[argc] = {"program", "--out=file.txt"};
+		Args args;
+		REQUIRE_EQ(args.parse(argc, argv), CMD::CommandLineArgs::ErrorCode::Success);
+		REQUIRE_EQ(args.get<"threads">(), nullptr);
+		REQUIRE_FALSE(*args.get<"flag">());
+	}
+
+	TEST_CASE("Errors match the runtime parser") {
+		Args args;
+		SUBCASE("Missing required parameter") {
+			char* argv[2] = {"program", "--flag"};
+			auto callback = [](CMD::CommandLineArgs::ErrorCode code, const char* param, const char* input, const char* description) -> void {
+				CHECK_EQ(code, CMD::CommandLineArgs::ErrorCode::MissingParameter);
+				CHECK_EQ(strcmp(param, "out"), 0);
+			};
+			REQUIRE_EQ(args.parse(2, argv, callback), CMD::CommandLineArgs::ErrorCode::MissingParameter);
+		}
+
+		SUBCASE("Unknown parameter") {
+			char* argv[2] = {"program", "--thread=1"};
+			REQUIRE_EQ(args.parse(2, argv), CMD::CommandLineArgs::ErrorCode::UnknownParameter);
+		}
+
+		SUBCASE("Wrong value type") {
+			char* argv[3] = {"program", "--out=a", "--threads=8a"};
+			REQUIRE_EQ(args.parse(3, argv), CMD::CommandLineArgs::ErrorCode::WrongValueType);
+			REQUIRE_EQ(args.get<"threads">(), nullptr);
+		}
+	}
+
+	TEST_CASE("Perfect hash finds every name") {
+		constexpr std::array<std::string_view, 6> names = {"a", "b", "threads", "thread", "out", "input-file"};
+		constexpr auto table = CMD::detail::buildPerfectHash(names);
+		for (std::size_t i = 0; i < names.size(); ++i) {
+			REQUIRE_EQ(table.find(names[i], names.data()), int(i));
+		}
+		REQUIRE_EQ(table.find("threadz", names.data()), -1);
+		REQUIRE_EQ(table.find("", names.data()), -1);
+	}
 }
\ No newline at end of file